@@ -1,11 +1,47 @@
 #include "include/APU.hpp"
+#include <algorithm>
 
-APU::APU()
+namespace
 {
+    const uint8_t lengthTable[32] =
+    {
+        10, 254, 20,  2, 40,  4, 80,  6, 160,  8, 60, 10, 14, 12, 26, 14,
+        12,  16, 24, 18, 48, 20, 96, 22, 192, 24, 72, 26, 16, 28, 32, 30
+    };
+
+    const uint8_t dutyTable[4][8] =
+    {
+        {0, 1, 0, 0, 0, 0, 0, 0},
+        {0, 1, 1, 0, 0, 0, 0, 0},
+        {0, 1, 1, 1, 1, 0, 0, 0},
+        {1, 0, 0, 1, 1, 1, 1, 1}
+    };
+
+    const uint8_t triangleSequence[32] =
+    {
+        15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1,  0,
+         0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15
+    };
+
+    //NTSC timer periods in CPU cycles
+    const uint16_t noisePeriods[16] = {4, 8, 16, 32, 64, 96, 128, 160, 202, 254, 380, 508, 762, 1016, 2034, 4068};
+    const uint16_t dmcRates[16] = {428, 380, 340, 320, 286, 254, 226, 214, 190, 160, 142, 128, 106, 84, 72, 54};
 
+    //Frame sequencer steps in CPU cycles after the sequence starts
+    const uint32_t fourStepSequence[4] = {7457, 14913, 22371, 29829};
+    const uint32_t fiveStepSequence[5] = {7457, 14913, 22371, 29829, 37281};
+    const uint32_t fourStepPeriod = 29830, fiveStepPeriod = 37282;
 }
 
-uint8_t APU::readMemMappedReg(uint16_t address) const
+APU::APU(Cartridge& cartridge, Scheduler& scheduler) : cart(cartridge), scheduler(scheduler), blip(clockRate, 48000)
+{
+    scheduler.setHandler(apuFrameIRQ, [this](uint64_t now){ runUntil(now / 3); scheduleIRQ(); });
+    resetSequence();
+    updateNextEvent();
+    scheduleIRQ();
+}
+
+uint8_t APU::readMemMappedReg(uint16_t address)
 {
     switch(address)
     {
@@ -50,7 +86,15 @@ uint8_t APU::readMemMappedReg(uint16_t address) const
         case 0x4013:
             return reg.DMC_LEN;
         case 0x4015:
-            return reg.SND_CHN;
+        {
+            //Reading the status acknowledges the frame interrupt, but not the DMC's
+            uint8_t status = (pulse1.length > 0 ? 0x01 : 0x00) | (pulse2.length > 0 ? 0x02 : 0x00) |
+                             (triangle.length > 0 ? 0x04 : 0x00) | (noise.length > 0 ? 0x08 : 0x00) |
+                             (dmc.bytesRemaining > 0 ? 0x10 : 0x00) | (frameIRQ ? 0x40 : 0x00) | (dmc.irq ? 0x80 : 0x00);
+            frameIRQ = false;
+            scheduleIRQ();
+            return status;
+        }
         case 0x4017:
             return reg.JOY2;
     }
@@ -59,78 +103,656 @@ uint8_t APU::readMemMappedReg(uint16_t address) const
 
 void APU::writeMemMappedReg(uint16_t address, uint8_t data)
 {
+    //Silent channels may be behind, they have to be where they would be before a write can wake them up
+    runChannels(cycle);
+
     switch(address)
     {
         case 0x4000:
             reg.SQ1_VOL = data;
+            pulse1.duty = data >> 6;
+            writeEnvelope(pulse1.envelope, data);
             break;
         case 0x4001:
             reg.SQ1_SWEEP = data;
+            pulse1.sweepEnabled = data & 0x80;
+            pulse1.sweepPeriod = (data >> 4) & 0x07;
+            pulse1.sweepNegate = data & 0x08;
+            pulse1.sweepShift = data & 0x07;
+            pulse1.sweepReload = true;
             break;
         case 0x4002:
             reg.SQ1_LO = data;
+            pulse1.timer = (pulse1.timer & 0x700) | data;
             break;
         case 0x4003:
             reg.SQ1_HI = data;
+            pulse1.timer = (pulse1.timer & 0xFF) | ((data & 0x07) << 8);
+            if(enabled & 0x01)
+                pulse1.length = lengthTable[data >> 3];
+            pulse1.phase = 0;
+            pulse1.envelope.start = true;
             break;
         case 0x4004:
             reg.SQ2_VOL = data;
+            pulse2.duty = data >> 6;
+            writeEnvelope(pulse2.envelope, data);
             break;
         case 0x4005:
             reg.SQ2_SWEEP = data;
+            pulse2.sweepEnabled = data & 0x80;
+            pulse2.sweepPeriod = (data >> 4) & 0x07;
+            pulse2.sweepNegate = data & 0x08;
+            pulse2.sweepShift = data & 0x07;
+            pulse2.sweepReload = true;
             break;
         case 0x4006:
             reg.SQ2_LO = data;
+            pulse2.timer = (pulse2.timer & 0x700) | data;
             break;
         case 0x4007:
             reg.SQ2_HI = data;
+            pulse2.timer = (pulse2.timer & 0xFF) | ((data & 0x07) << 8);
+            if(enabled & 0x02)
+                pulse2.length = lengthTable[data >> 3];
+            pulse2.phase = 0;
+            pulse2.envelope.start = true;
             break;
         case 0x4008:
             reg.TRI_LINEAR = data;
+            triangle.control = data & 0x80;
+            triangle.linearReload = data & 0x7F;
             break;
         case 0x4009:
             reg.UNUSED1 = data;
             break;
         case 0x400A:
             reg.TRI_LO = data;
+            triangle.timer = (triangle.timer & 0x700) | data;
             break;
         case 0x400B:
             reg.TRI_HI = data;
+            triangle.timer = (triangle.timer & 0xFF) | ((data & 0x07) << 8);
+            if(enabled & 0x04)
+                triangle.length = lengthTable[data >> 3];
+            triangle.linearReloadFlag = true;
             break;
         case 0x400C:
             reg.NOISE_VOL = data;
+            writeEnvelope(noise.envelope, data);
             break;
         case 0x400D:
             reg.UNUSED2 = data;
             break;
         case 0x400E:
             reg.NOISE_LO = data;
+            noise.shortMode = data & 0x80;
+            noise.periodIndex = data & 0x0F;
             break;
         case 0x400F:
             reg.NOISE_HI = data;
+            if(enabled & 0x08)
+                noise.length = lengthTable[data >> 3];
+            noise.envelope.start = true;
             break;
         case 0x4010:
             reg.DMC_FREQ = data;
+            dmc.irqEnabled = data & 0x80;
+            dmc.loop = data & 0x40;
+            dmc.rateIndex = data & 0x0F;
+            if(!dmc.irqEnabled)
+                dmc.irq = false;
             break;
         case 0x4011:
             reg.DMC_RAW = data;
+            dmc.level = data & 0x7F;
             break;
         case 0x4012:
             reg.DMC_START = data;
+            dmc.sampleAddress = 0xC000 + (data << 6);
             break;
         case 0x4013:
             reg.DMC_LEN = data;
+            dmc.sampleLength = (data << 4) + 1;
             break;
         case 0x4015:
             reg.SND_CHN = data;
+            enabled = data & 0x1F;
+            if(!(enabled & 0x01))
+                pulse1.length = 0;
+            if(!(enabled & 0x02))
+                pulse2.length = 0;
+            if(!(enabled & 0x04))
+                triangle.length = 0;
+            if(!(enabled & 0x08))
+                noise.length = 0;
+            dmc.irq = false;
+            if(!(enabled & 0x10))
+                dmc.bytesRemaining = 0;
+            else if(dmc.bytesRemaining == 0)
+            {
+                restartSample();
+                fetchSample();
+            }
             break;
         case 0x4017:
             reg.JOY2 = data;
+            fiveStep = data & 0x80;
+            irqInhibit = data & 0x40;
+            if(irqInhibit)
+                frameIRQ = false;
+            resetSequence();
+            if(fiveStep)
+            {
+                quarterFrame();
+                halfFrame();
+            }
             break;
     }
+    updateLevels();
+    updateNextEvent();
+    scheduleIRQ();
+}
+
+void APU::run(uint64_t end)
+{
+    while(cycle < end)
+    {
+        runChannels(std::min({end, nextFrameStep, frameStart + maxFrameCycles}));
+
+        if(cycle == nextFrameStep)
+            clockFrameSequencer();
+        if(cycle - frameStart >= maxFrameCycles)
+            closeFrame();
+    }
+    updateNextEvent();
+    scheduleIRQ();
+}
+
+void APU::scheduleIRQ()
+{
+    //Step 3 of the four step sequence is always still ahead, frameStep wraps as soon as it has run
+    uint64_t next = UINT64_MAX;
+    if(!fiveStep && !irqInhibit && !frameIRQ)
+        next = sequenceStart + fourStepSequence[3];
+
+    //With a full sample buffer the next fetch comes when the shifter runs out of bits, then one every eight DMC clocks.
+    //The IRQ is raised by the fetch of the last byte, one cycle is added because runs stop short of their end
+    if(dmc.irqEnabled && !dmc.loop && !dmc.irq && dmc.bytesRemaining > 0 && !dmc.bufferEmpty)
+    {
+        uint64_t period = dmcRates[dmc.rateIndex];
+        uint64_t lastFetch = dmc.next + (dmc.bitsRemaining - 1) * period + (dmc.bytesRemaining - 1) * 8 * period;
+        next = std::min(next, lastFetch + 1);
+    }
+
+    if(next == UINT64_MAX)
+        scheduler.cancel(apuFrameIRQ);
+    else
+        scheduler.schedule(apuFrameIRQ, next * 3);
+}
+
+void APU::updateNextEvent()
+{
+    nextEvent = std::min(nextFrameStep, frameStart + maxFrameCycles);
+    if(pulseVolume(pulse1, true))
+        nextEvent = std::min(nextEvent, pulse1.next);
+    if(pulseVolume(pulse2, false))
+        nextEvent = std::min(nextEvent, pulse2.next);
+    if(triangle.length > 0 && triangle.linearCounter > 0 && triangle.timer >= 2)
+        nextEvent = std::min(nextEvent, triangle.next);
+    if(noiseVolume())
+        nextEvent = std::min(nextEvent, noise.next);
+    if(!dmc.silence || !dmc.bufferEmpty || dmc.bytesRemaining > 0)
+        nextEvent = std::min(nextEvent, dmc.next);
+}
+
+void APU::endFrame(uint64_t end)
+{
+    run(end);
+    closeFrame();
+    updateNextEvent();
+}
+
+void APU::closeFrame()
+{
+    //With output off nothing was added, so the buffer doesn't move either
+    if(outputEnabled)
+        blip.endFrame((uint32_t)(cycle - frameStart));
+    frameStart = cycle;
+}
+
+size_t APU::readSamples(int16_t* out, size_t count)
+{
+    return blip.readSamples(out, count);
+}
+
+void APU::setSampleRate(int rate)
+{
+    blip.setRates(clockRate, rate);
+    frameStart = cycle;
+    blipLevel = 0;
+    syncOutput();
+    updateNextEvent();
+}
+
+void APU::setOutputEnabled(bool enabled)
+{
+    outputEnabled = enabled;
+    syncOutput();
+}
+
+void APU::runChannels(uint64_t end)
+{
+    runPulse(pulse1, true, end);
+    runPulse(pulse2, false, end);
+    runTriangle(end);
+    runNoise(end);
+    runDMC(end);
+    cycle = end;
+}
+
+void APU::runPulse(Pulse& pulse, bool onesComplement, uint64_t end)
+{
+    uint32_t period = (pulse.timer + 1) * 2;
+    uint64_t time = pulse.next;
+    int volume = pulseVolume(pulse, onesComplement);
+
+    if(volume == 0)
+    {
+        //Silent, only the duty position has to keep moving
+        if(time < end)
+        {
+            uint64_t clocks = (end - time - 1) / period + 1;
+            pulse.phase = (pulse.phase + clocks) & 0x07;
+            time += clocks * period;
+        }
+    }
+    else
+    {
+        for(; time < end; time += period)
+        {
+            pulse.phase = (pulse.phase + 1) & 0x07;
+            setLevel(pulse.output, dutyTable[pulse.duty][pulse.phase] * volume, pulseWeight, time);
+        }
+    }
+    pulse.next = time;
+}
+
+void APU::runTriangle(uint64_t end)
+{
+    uint32_t period = triangle.timer + 1;
+    uint64_t time = triangle.next;
+
+    //Periods under 2 are ultrasonic, holding the level is closer to what comes out of the filters than stepping it
+    if(triangle.length == 0 || triangle.linearCounter == 0 || triangle.timer < 2)
+    {
+        if(time < end)
+            time += ((end - time - 1) / period + 1) * period;
+    }
+    else
+    {
+        for(; time < end; time += period)
+        {
+            triangle.phase = (triangle.phase + 1) & 0x1F;
+            setLevel(triangle.output, triangleSequence[triangle.phase], triangleWeight, time);
+        }
+    }
+    triangle.next = time;
+}
+
+void APU::runNoise(uint64_t end)
+{
+    uint32_t period = noisePeriods[noise.periodIndex];
+    uint64_t time = noise.next;
+    int volume = noiseVolume();
+    int tap = noise.shortMode ? 6 : 1;
+
+    for(; time < end; time += period)
+    {
+        uint16_t feedback = (noise.shifter ^ (noise.shifter >> tap)) & 0x01;
+        noise.shifter = (noise.shifter >> 1) | (feedback << 14);
+        if(volume)
+            setLevel(noise.output, (noise.shifter & 0x01) ? 0 : volume, noiseWeight, time);
+    }
+    noise.next = time;
+}
+
+void APU::runDMC(uint64_t end)
+{
+    uint32_t period = dmcRates[dmc.rateIndex];
+    uint64_t time = dmc.next;
+
+    for(; time < end; time += period)
+    {
+        if(!dmc.silence)
+        {
+            if(dmc.shifter & 0x01)
+            {
+                if(dmc.level <= 125)
+                    dmc.level += 2;
+            }
+            else if(dmc.level >= 2)
+                dmc.level -= 2;
+            setLevel(dmc.output, dmc.level, dmcWeight, time);
+        }
+        dmc.shifter >>= 1;
+
+        if(--dmc.bitsRemaining == 0)
+        {
+            dmc.bitsRemaining = 8;
+            dmc.silence = dmc.bufferEmpty;
+            if(!dmc.bufferEmpty)
+            {
+                dmc.shifter = dmc.sampleBuffer;
+                dmc.bufferEmpty = true;
+                fetchSample();
+            }
+        }
+    }
+    dmc.next = time;
+}
+
+void APU::fetchSample()
+{
+    //The real fetch steals CPU cycles, that stall isn't emulated
+    if(!dmc.bufferEmpty || dmc.bytesRemaining == 0)
+        return;
+
+    dmc.sampleBuffer = cart.readPRG(dmc.address);
+    dmc.bufferEmpty = false;
+    dmc.address = (dmc.address == 0xFFFF) ? 0x8000 : dmc.address + 1;
+
+    if(--dmc.bytesRemaining == 0)
+    {
+        if(dmc.loop)
+            restartSample();
+        else if(dmc.irqEnabled)
+            dmc.irq = true;
+    }
+}
+
+void APU::restartSample()
+{
+    dmc.address = dmc.sampleAddress;
+    dmc.bytesRemaining = dmc.sampleLength;
+}
+
+void APU::resetSequence()
+{
+    sequenceStart = cycle;
+    frameStep = 0;
+    nextFrameStep = sequenceStart + fourStepSequence[0];
+}
+
+void APU::clockFrameSequencer()
+{
+    if(fiveStep)
+    {
+        if(frameStep != 3)
+            quarterFrame();
+        if(frameStep == 1 || frameStep == 4)
+            halfFrame();
+    }
+    else
+    {
+        quarterFrame();
+        if(frameStep & 0x01)
+            halfFrame();
+        if(frameStep == 3 && !irqInhibit)
+            frameIRQ = true;
+    }
+
+    if(++frameStep == (fiveStep ? 5 : 4))
+    {
+        frameStep = 0;
+        sequenceStart += fiveStep ? fiveStepPeriod : fourStepPeriod;
+    }
+    nextFrameStep = sequenceStart + (fiveStep ? fiveStepSequence : fourStepSequence)[frameStep];
+    updateLevels();
+}
+
+void APU::quarterFrame()
+{
+    clockEnvelope(pulse1.envelope);
+    clockEnvelope(pulse2.envelope);
+    clockEnvelope(noise.envelope);
+
+    if(triangle.linearReloadFlag)
+        triangle.linearCounter = triangle.linearReload;
+    else if(triangle.linearCounter > 0)
+        --triangle.linearCounter;
+    if(!triangle.control)
+        triangle.linearReloadFlag = false;
+}
+
+void APU::halfFrame()
+{
+    //The envelope loop flag and the triangle's control flag double as length counter halts
+    if(pulse1.length > 0 && !pulse1.envelope.loop)
+        --pulse1.length;
+    if(pulse2.length > 0 && !pulse2.envelope.loop)
+        --pulse2.length;
+    if(triangle.length > 0 && !triangle.control)
+        --triangle.length;
+    if(noise.length > 0 && !noise.envelope.loop)
+        --noise.length;
+
+    clockSweep(pulse1, true);
+    clockSweep(pulse2, false);
+}
+
+void APU::writeEnvelope(Envelope& envelope, uint8_t data)
+{
+    envelope.loop = data & 0x20;
+    envelope.constant = data & 0x10;
+    envelope.period = data & 0x0F;
+}
+
+void APU::clockEnvelope(Envelope& envelope)
+{
+    if(envelope.start)
+    {
+        envelope.start = false;
+        envelope.decay = 15;
+        envelope.divider = envelope.period;
+    }
+    else if(envelope.divider == 0)
+    {
+        envelope.divider = envelope.period;
+        if(envelope.decay > 0)
+            --envelope.decay;
+        else if(envelope.loop)
+            envelope.decay = 15;
+    }
+    else
+        --envelope.divider;
+}
+
+uint8_t APU::envelopeVolume(const Envelope& envelope) const
+{
+    return envelope.constant ? envelope.period : envelope.decay;
+}
+
+uint16_t APU::sweepTarget(const Pulse& pulse, bool onesComplement) const
+{
+    //Pulse 1 negates with ones' complement, so it goes one further down than pulse 2
+    int change = pulse.timer >> pulse.sweepShift;
+    if(pulse.sweepNegate)
+        return std::max(0, pulse.timer - change - (onesComplement ? 1 : 0));
+    return pulse.timer + change;
+}
+
+void APU::clockSweep(Pulse& pulse, bool onesComplement)
+{
+    if(pulse.sweepDivider == 0 && pulse.sweepEnabled && pulse.sweepShift > 0 && !sweepMuted(pulse, onesComplement))
+        pulse.timer = sweepTarget(pulse, onesComplement);
+
+    if(pulse.sweepDivider == 0 || pulse.sweepReload)
+    {
+        pulse.sweepDivider = pulse.sweepPeriod;
+        pulse.sweepReload = false;
+    }
+    else
+        --pulse.sweepDivider;
+}
+
+bool APU::sweepMuted(const Pulse& pulse, bool onesComplement) const
+{
+    return pulse.timer < 8 || sweepTarget(pulse, onesComplement) > 0x7FF;
+}
+
+int APU::pulseVolume(const Pulse& pulse, bool onesComplement) const
+{
+    if(pulse.length == 0 || sweepMuted(pulse, onesComplement))
+        return 0;
+    return envelopeVolume(pulse.envelope);
+}
+
+int APU::noiseVolume() const
+{
+    return noise.length > 0 ? envelopeVolume(noise.envelope) : 0;
+}
+
+void APU::setLevel(int& output, int level, int weight, uint64_t time)
+{
+    if(level == output)
+        return;
+
+    if(outputEnabled)
+    {
+        blip.addDelta((uint32_t)(time - frameStart), (level - output) * weight);
+        blipLevel += (level - output) * weight;
+    }
+    output = level;
+}
+
+void APU::updateLevels()
+{
+    //Register writes and frame sequencer clocks can change volumes between timer clocks, the triangle only moves on its timer
+    setLevel(pulse1.output, dutyTable[pulse1.duty][pulse1.phase] * pulseVolume(pulse1, true), pulseWeight, cycle);
+    setLevel(pulse2.output, dutyTable[pulse2.duty][pulse2.phase] * pulseVolume(pulse2, false), pulseWeight, cycle);
+    setLevel(noise.output, (noise.shifter & 0x01) ? 0 : noiseVolume(), noiseWeight, cycle);
+    setLevel(dmc.output, dmc.level, dmcWeight, cycle);
+}
+
+void APU::syncOutput()
+{
+    if(!outputEnabled)
+        return;
+
+    int level = (pulse1.output + pulse2.output) * pulseWeight + triangle.output * triangleWeight +
+                noise.output * noiseWeight + dmc.output * dmcWeight;
+    if(level != blipLevel)
+    {
+        blip.addDelta((uint32_t)(cycle - frameStart), level - blipLevel);
+        blipLevel = level;
+    }
+}
+
+//Channels are saved a field at a time, copying the structs whole would take their padding along
+void APU::Envelope::serialize(SaveState& state)
+{
+    state.field(start);
+    state.field(loop);
+    state.field(constant);
+    state.field(period);
+    state.field(divider);
+    state.field(decay);
+}
+
+void APU::Pulse::serialize(SaveState& state)
+{
+    envelope.serialize(state);
+    state.field(duty);
+    state.field(phase);
+    state.field(timer);
+    state.field(length);
+    state.field(sweepEnabled);
+    state.field(sweepNegate);
+    state.field(sweepReload);
+    state.field(sweepPeriod);
+    state.field(sweepShift);
+    state.field(sweepDivider);
+    state.field(next);
+    state.field(output);
+}
+
+void APU::Triangle::serialize(SaveState& state)
+{
+    state.field(control);
+    state.field(linearReload);
+    state.field(linearCounter);
+    state.field(linearReloadFlag);
+    state.field(timer);
+    state.field(length);
+    state.field(phase);
+    state.field(next);
+    state.field(output);
+}
+
+void APU::Noise::serialize(SaveState& state)
+{
+    envelope.serialize(state);
+    state.field(shortMode);
+    state.field(periodIndex);
+    state.field(shifter);
+    state.field(length);
+    state.field(next);
+    state.field(output);
+}
+
+void APU::DMC::serialize(SaveState& state)
+{
+    state.field(irqEnabled);
+    state.field(loop);
+    state.field(irq);
+    state.field(rateIndex);
+    state.field(level);
+    state.field(sampleAddress);
+    state.field(sampleLength);
+    state.field(address);
+    state.field(bytesRemaining);
+    state.field(sampleBuffer);
+    state.field(bufferEmpty);
+    state.field(shifter);
+    state.field(bitsRemaining);
+    state.field(silence);
+    state.field(next);
+    state.field(output);
+}
+
+void APU::serialize(SaveState& state)
+{
+    //Silent channels are brought up to date first so the same moment always saves the same bytes
+    if(!state.isLoading())
+        runChannels(cycle);
+
+    state.field(reg);
+    pulse1.serialize(state);
+    pulse2.serialize(state);
+    triangle.serialize(state);
+    noise.serialize(state);
+    dmc.serialize(state);
+    state.field(enabled);
+    state.field(fiveStep);
+    state.field(irqInhibit);
+    state.field(frameIRQ);
+    state.field(frameStep);
+    state.field(sequenceStart);
+    state.field(nextFrameStep);
+    state.field(cycle);
+
+    //The loaded levels may not be the ones the buffer was left at, a step at the start of the new frame joins them up
+    if(state.isLoading())
+    {
+        frameStart = cycle;
+        syncOutput();
+        updateNextEvent();
+        scheduleIRQ();
+    }
 }
 
 APU::~APU()
 {
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,55 @@
+#include "include/AudioRing.hpp"
+#include <algorithm>
+
+AudioRing::AudioRing(size_t capacity) : writeCount(0), readCount(0)
+{
+	size_t size = 1;
+	while(size < capacity)
+		size <<= 1;
+	buffer.resize(size);
+	mask = size - 1;
+}
+
+size_t AudioRing::write(const int16_t* samples, size_t count)
+{
+	size_t written = writeCount.load(std::memory_order_relaxed);
+	size_t read = readCount.load(std::memory_order_acquire);
+	count = std::min(count, capacity() - (written - read));
+
+	//At most two copies, up to the end of the buffer and then from its start
+	size_t start = written & mask;
+	size_t first = std::min(count, capacity() - start);
+	std::copy(samples, samples + first, buffer.begin() + start);
+	std::copy(samples + first, samples + count, buffer.begin());
+
+	//Release publishes the samples together with the new count
+	writeCount.store(written + count, std::memory_order_release);
+	return count;
+}
+
+size_t AudioRing::read(int16_t* samples, size_t count)
+{
+	size_t read = readCount.load(std::memory_order_relaxed);
+	size_t written = writeCount.load(std::memory_order_acquire);
+	count = std::min(count, written - read);
+
+	size_t start = read & mask;
+	size_t first = std::min(count, capacity() - start);
+	std::copy(buffer.begin() + start, buffer.begin() + start + first, samples);
+	std::copy(buffer.begin(), buffer.begin() + (count - first), samples + first);
+
+	//Release hands the space back to the producer only after the samples were copied out
+	readCount.store(read + count, std::memory_order_release);
+	return count;
+}
+
+size_t AudioRing::size() const
+{
+	size_t read = readCount.load(std::memory_order_acquire);
+	return writeCount.load(std::memory_order_acquire) - read;
+}
+
+AudioRing::~AudioRing()
+{
+
+}
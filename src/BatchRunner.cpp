@@ -0,0 +1,104 @@
+#include "include/BatchRunner.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <thread>
+#include "include/NES.hpp"
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+BatchRunner::BatchRunner(unsigned threads) : threads(threads)
+{
+	if(this->threads == 0)
+		this->threads = std::max(1u, std::thread::hardware_concurrency());
+}
+
+std::vector<BatchResult> BatchRunner::run(const std::vector<BatchJob>& jobs)
+{
+	std::vector<BatchResult> results(jobs.size());
+	std::atomic<size_t> nextJob(0);
+
+	auto worker = [&](unsigned core)
+	{
+		pinToCore(core);
+		std::vector<uint8_t> pixels(256 * 240 * 3);
+		for(size_t i = nextJob++; i < jobs.size(); i = nextJob++)
+			results[i] = runJob(jobs[i], pixels);
+	};
+
+	unsigned workers = std::min<size_t>(threads, jobs.size());
+	std::vector<std::thread> pool;
+	pool.reserve(workers);
+	for(unsigned core = 0; core < workers; ++core)
+		pool.emplace_back(worker, core);
+	for(std::thread& thread : pool)
+		thread.join();
+
+	return results;
+}
+
+BatchResult BatchRunner::runJob(const BatchJob& job, std::vector<uint8_t>& pixels)
+{
+	BatchResult result;
+	auto start = std::chrono::steady_clock::now();
+
+	try
+	{
+		NES nes(roms.load(job.romPath.c_str()));
+		nes.setExecutionMode(job.mode);
+		for(long frame = 0; frame < job.frames; ++frame)
+		{
+			nes.setButtons(0, (size_t)frame < job.movie.size() ? job.movie[frame] : 0x00);
+			nes.prepareFrame();
+		}
+
+		nes.renderFrame(RGB24, pixels.data(), 256 * 3);
+		uint64_t hash = 14695981039346656037ull;
+		for(uint8_t byte : pixels)
+			hash = (hash ^ byte) * 1099511628211ull;
+
+		result.ok = true;
+		result.cycles = nes.elapsedCycles();
+		result.frameHash = hash;
+	}
+	catch(std::exception& e)
+	{
+		result.error = e.what();
+	}
+
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return result;
+}
+
+void BatchRunner::pinToCore(unsigned core)
+{
+#if defined(__linux__)
+	//Take the core'th of the cores this process may run on, the process might be limited to some of them already
+	cpu_set_t allowed;
+	if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0)
+		return;
+
+	int skip = core % CPU_COUNT(&allowed);
+	for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+	{
+		if(!CPU_ISSET(cpu, &allowed) || skip-- > 0)
+			continue;
+
+		cpu_set_t pinned;
+		CPU_ZERO(&pinned);
+		CPU_SET(cpu, &pinned);
+		pthread_setaffinity_np(pthread_self(), sizeof(pinned), &pinned);
+		return;
+	}
+#else
+	(void)core;
+#endif
+}
+
+BatchRunner::~BatchRunner()
+{
+
+}
@@ -0,0 +1,211 @@
+#include "include/BlipBuffer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BLIP_X86
+#include <immintrin.h>
+#endif
+
+BlipBuffer::BlipBuffer(double clockRate, int sampleRate) : avx2(hasAVX2())
+{
+	setRates(clockRate, sampleRate);
+}
+
+void BlipBuffer::setRates(double clockRate, int sampleRate)
+{
+	samplesPerClock = sampleRate / clockRate;
+	adjustRate(1.0);
+
+	//A quarter of a second of backlog, plus room for a long frame and the kernel past its end
+	maxBuffered = sampleRate / 4;
+	buffer.assign(maxBuffered + sampleRate / 10 + taps, 0);
+
+	const double pi = 3.14159265358979323846;
+	double dt = 1.0 / sampleRate;
+	auto highPassCoefficient = [&](double cutoff){ double rc = 1.0 / (2.0 * pi * cutoff); return rc / (rc + dt); };
+	auto lowPassCoefficient = [&](double cutoff){ double rc = 1.0 / (2.0 * pi * cutoff); return dt / (rc + dt); };
+	highPass90.coefficient = (int32_t)std::lround(highPassCoefficient(90.0) * 65536.0);
+	highPass440.coefficient = (int32_t)std::lround(highPassCoefficient(440.0) * 65536.0);
+	lowPass14k.coefficient = (int32_t)std::lround(lowPassCoefficient(14000.0) * 65536.0);
+	clear();
+}
+
+void BlipBuffer::adjustRate(double ratio)
+{
+	factor = (uint64_t)std::llround(samplesPerClock * ratio * 4294967296.0);
+}
+
+void BlipBuffer::addDelta(uint32_t time, int delta)
+{
+	uint64_t position = offset + (uint64_t)time * factor;
+	int32_t* out = &buffer[position >> fracBits];
+	int phase = (position >> (fracBits - phaseBits)) & (phaseCount - 1);
+
+	//The vector paths multiply 16 bit halves, anything wider than a full scale step takes the scalar loop
+	if(delta != (int16_t)delta)
+		addDeltaScalar(out, phase, delta);
+	else if(avx2)
+		addDeltaAVX2(out, phase, delta);
+	else
+		addDeltaSSE2(out, phase, delta);
+}
+
+void BlipBuffer::addDeltaScalar(int32_t* out, int phase, int delta)
+{
+	const int16_t* step = kernel().rows[phase];
+	for(int i = 0; i < taps; ++i)
+		out[i] += step[i] * delta;
+}
+
+#if defined(BLIP_X86) && defined(__SSE2__)
+void BlipBuffer::addDeltaSSE2(int32_t* out, int phase, int delta)
+{
+	//Four taps per multiply-add, the zero upper half of each widened tap meets the zero upper half of the delta
+	const int32_t* step = kernel().widened[phase];
+	const __m128i scale = _mm_set1_epi32(delta & 0xFFFF);
+	for(int i = 0; i < taps; i += 4)
+	{
+		__m128i products = _mm_madd_epi16(_mm_load_si128((const __m128i*)(step + i)), scale);
+		__m128i sum = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(out + i)), products);
+		_mm_storeu_si128((__m128i*)(out + i), sum);
+	}
+}
+#else
+void BlipBuffer::addDeltaSSE2(int32_t* out, int phase, int delta)
+{
+	addDeltaScalar(out, phase, delta);
+}
+#endif
+
+#ifdef BLIP_X86
+__attribute__((target("avx2")))
+void BlipBuffer::addDeltaAVX2(int32_t* out, int phase, int delta)
+{
+	const int32_t* step = kernel().widened[phase];
+	const __m256i scale = _mm256_set1_epi32(delta & 0xFFFF);
+	for(int i = 0; i < taps; i += 8)
+	{
+		__m256i products = _mm256_madd_epi16(_mm256_load_si256((const __m256i*)(step + i)), scale);
+		__m256i sum = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(out + i)), products);
+		_mm256_storeu_si256((__m256i*)(out + i), sum);
+	}
+}
+
+bool BlipBuffer::hasAVX2()
+{
+	return __builtin_cpu_supports("avx2");
+}
+#else
+void BlipBuffer::addDeltaAVX2(int32_t* out, int phase, int delta)
+{
+	addDeltaScalar(out, phase, delta);
+}
+
+bool BlipBuffer::hasAVX2()
+{
+	return false;
+}
+#endif
+
+void BlipBuffer::endFrame(uint32_t duration)
+{
+	offset += (uint64_t)duration * factor;
+
+	size_t available = samplesAvailable();
+	if(available > maxBuffered)
+		readSamples(nullptr, available - maxBuffered);
+}
+
+size_t BlipBuffer::readSamples(int16_t* out, size_t count)
+{
+	count = std::min(count, samplesAvailable());
+
+	//Integrating and filtering are recurrences, each sample needs the one before it, so they share one pass over the block
+	int32_t sum = integrator;
+	for(size_t i = 0; i < count; ++i)
+	{
+		sum += buffer[i];
+		int32_t sample = lowPass(lowPass14k, highPass(highPass440, highPass(highPass90, sum >> deltaBits)));
+
+		if(out)
+			out[i] = (int16_t)std::max(-32768, std::min(32767, sample));
+	}
+	integrator = sum;
+
+	//Whatever was added past the samples read, including the tails of the last steps, moves to the front
+	size_t remaining = samplesAvailable() - count + taps;
+	std::memmove(buffer.data(), buffer.data() + count, remaining * sizeof(int32_t));
+	std::fill(buffer.begin() + remaining, buffer.begin() + remaining + count, 0);
+	offset -= (uint64_t)count << fracBits;
+	return count;
+}
+
+int32_t BlipBuffer::highPass(Filter& filter, int32_t sample)
+{
+	filter.output = (int32_t)(((int64_t)filter.output + sample - filter.input) * filter.coefficient >> 16);
+	filter.input = sample;
+	return filter.output;
+}
+
+int32_t BlipBuffer::lowPass(Filter& filter, int32_t sample)
+{
+	filter.output += (int32_t)((int64_t)(sample - filter.output) * filter.coefficient >> 16);
+	return filter.output;
+}
+
+void BlipBuffer::clear()
+{
+	offset = 0;
+	integrator = 0;
+	highPass90.input = highPass90.output = 0;
+	highPass440.input = highPass440.output = 0;
+	lowPass14k.input = lowPass14k.output = 0;
+	std::fill(buffer.begin(), buffer.end(), 0);
+}
+
+BlipBuffer::Kernel::Kernel()
+{
+	//Blackman windowed sinc with its cutoff a little under half the sample rate, one row per sub-sample phase. Rows are
+	//rounded to sum to exactly 1 << deltaBits so a step always settles at the full delta
+	const double pi = 3.14159265358979323846;
+	const double cutoff = 0.45;
+	for(int phase = 0; phase < phaseCount; ++phase)
+	{
+		double weights[BlipBuffer::taps];
+		double total = 0.0;
+		for(int i = 0; i < BlipBuffer::taps; ++i)
+		{
+			double t = i - BlipBuffer::taps / 2 - (double)phase / phaseCount;
+			double sinc = (t == 0.0) ? 1.0 : std::sin(2.0 * pi * cutoff * t) / (2.0 * pi * cutoff * t);
+			double window = 0.42 + 0.5 * std::cos(pi * t / (BlipBuffer::taps / 2)) + 0.08 * std::cos(2.0 * pi * t / (BlipBuffer::taps / 2));
+			weights[i] = sinc * std::max(0.0, window);
+			total += weights[i];
+		}
+
+		int sum = 0, largest = 0;
+		for(int i = 0; i < BlipBuffer::taps; ++i)
+		{
+			rows[phase][i] = (int16_t)std::lround(weights[i] / total * (1 << deltaBits));
+			sum += rows[phase][i];
+			if(rows[phase][i] > rows[phase][largest])
+				largest = i;
+		}
+		rows[phase][largest] += (1 << deltaBits) - sum;
+
+		for(int i = 0; i < BlipBuffer::taps; ++i)
+			widened[phase][i] = (uint16_t)rows[phase][i];
+	}
+}
+
+const BlipBuffer::Kernel& BlipBuffer::kernel()
+{
+	static const Kernel table;
+	return table;
+}
+
+BlipBuffer::~BlipBuffer()
+{
+
+}
@@ -1,7 +1,7 @@
 #include "include/CPU.hpp"
 
-CPU::CPU(Cartridge* cart, PPU& ppu, APU& apu, Controllers& controllers) 
-: cart(*cart), ppu(ppu), apu(apu), controllers(controllers)
+CPU::CPU(Cartridge* cart, PPU& ppu, APU& apu, Controllers& controllers, Scheduler& scheduler) 
+: cart(*cart), ppu(ppu), apu(apu), controllers(controllers), scheduler(scheduler)
 {
 	//TODO: set noise channel
 
@@ -11,6 +11,11 @@ CPU::CPU(Cartridge* cart, PPU& ppu, APU& apu, Controllers& controllers)
 
 	totalCycles = 0;
 
+	buildMemoryMap();
+
+	scheduler.setHandler(nmiRaised, [this](uint64_t now){ (void)now; nmiLine = this->ppu.NMI(); });
+	scheduler.setHandler(dmaEnd, [this](uint64_t now){ (void)now; finishDMA(); });
+
 	Reset_Vector();
 
 	readOPCode();
@@ -32,7 +37,29 @@ void CPU::tick()
 	else if(cycleCount == 1)
 		decodeOP();
 	else
-		tickFunction();
+		(this->*tickFunction)();
+
+	++cycles;
+}
+
+void CPU::step()
+{
+	//Runs to the end of the current instruction, one tick() per cycle as in cycle stepped mode: bus accesses need cycles to
+	//be current when they sync the PPU. What this mode batches is the PPU, which only catches up on register access and
+	//scheduled events instead of three dots after every cycle
+	do
+		tick();
+	while(cycleCount != 0);
+}
+
+void CPU::syncPPU()
+{
+	ppu.catchUp(cycles * 3);
+}
+
+void CPU::setExecutionMode(ExecutionMode mode)
+{
+	executionMode = mode;
 }
 
 CPU::~CPU() {}
@@ -58,7 +85,13 @@ void CPU::executeDMATransfer()
 	}
 }
 
-void CPU::NMI()
+void CPU::finishDMA()
+{
+	for(int i = 0; i < 0x100; ++i)
+		write(0x2004, read(dmaPage + dmaLowByte++));
+}
+
+void CPU::interrupt()
 {
 	switch(cycleCount)
 	{
@@ -80,13 +113,14 @@ void CPU::NMI()
 			temp |= 0x20;
 			temp &= 0xEF;
 			push(temp);
+			set_interrupt(true);
 			break;
 		}
 		case 6:
-			addressBus = read(0xFFFA);
+			addressBus = read(interruptVector);
 			break;
 		case 7:
-			addressBus = (read(0xFFFB) << 8) + addressBus;
+			addressBus = (read(interruptVector + 1) << 8) + addressBus;
 			break;
 		case 8:
 			reg.PC = addressBus;
@@ -94,14 +128,53 @@ void CPU::NMI()
 	}
 }
 
-uint8_t CPU::read(uint16_t address) const
+void CPU::buildMemoryMap()
 {
-	if(address < 0x2000) //Internal RAM
-		return RAM[address % 0x0800];
-	else if(address < 0x4000) //PPU registers
-		return ppu.readMemMappedReg(address);
-	else if(address < 0x4016) //APU or I/O Registers
+	for(int page = 0x00; page < 0x100; ++page)
+	{
+		readPages[page] = writePages[page] = nullptr;
+
+		if(page < 0x20) //Internal RAM, mirrored every 0x800 bytes
+			readPages[page] = writePages[page] = &RAM[(page % 0x08) << 8];
+		else if(page < 0x40) //PPU registers
+		{
+			readHandlers[page] = &CPU::readPPU;
+			writeHandlers[page] = &CPU::writePPU;
+		}
+		else if(page == 0x40) //APU and I/O registers share their page with the start of cartridge space
+		{
+			readHandlers[page] = &CPU::readIO;
+			writeHandlers[page] = &CPU::writeIO;
+		}
+		else //Cartridge space, PRG pages are filled in by the mapper
+		{
+			readHandlers[page] = &CPU::readCartridge;
+			writeHandlers[page] = &CPU::writeCartridge;
+		}
+	}
+
+	cart.attachMemoryMap(readPages, writePages);
+}
+
+uint8_t CPU::readPPU(uint16_t address)
+{
+	syncPPU();
+	return ppu.readMemMappedReg(address);
+}
+
+void CPU::writePPU(uint16_t address, uint8_t data)
+{
+	syncPPU();
+	ppu.writeMemMappedReg(address, data);
+}
+
+uint8_t CPU::readIO(uint16_t address)
+{
+	if(address < 0x4016) //APU or I/O Registers
+	{
+		apu.runUntil(cycles);
 		return apu.readMemMappedReg(address);
+	}
 	else if(address < 0x4018)
 		return controllers.read(address);
 	else if(address < 0x4020) //Disabled APU and I/O Functionality
@@ -110,28 +183,70 @@ uint8_t CPU::read(uint16_t address) const
 		return cart.readPRG(address);
 }
 
-void CPU::write(uint16_t address, uint8_t data)
+void CPU::writeIO(uint16_t address, uint8_t data)
 {
-	if(address < 0x2000) //Internal RAM
-		RAM[address % 0x0800] = data;
-	else if(address < 0x4000) //PPU registers
-		ppu.writeMemMappedReg(address, data);
-	else if(address == 0x4014) //Trigger DMA Transfer
+	if(address == 0x4014) //Trigger DMA Transfer
 	{
-		dmaTransfer = true;
+		syncPPU();
 		dmaPage = (data << 8);
 		dmaLowByte = 0x00;
 		dmaTransferCycles = 513 + (oddCycle ? 1 : 0);
-		cycleCountReturn = cycleCount;
+
+		if(executionMode == instructionStepped) //Stall for the whole transfer at once and fill OAM when it ends
+		{
+			cycles += dmaTransferCycles;
+			totalCycles += dmaTransferCycles;
+			oddCycle ^= (dmaTransferCycles & 0x01);
+			scheduler.schedule(dmaEnd, (cycles + 1) * 3);
+		}
+		else
+		{
+			dmaTransfer = true;
+			cycleCountReturn = cycleCount;
+		}
 	}
 	else if(address == 0x4016)
 		controllers.write(data);
 	else if(address < 0x4018) //APU or I/O Registers
+	{
+		apu.runUntil(cycles);
 		apu.writeMemMappedReg(address, data);
+	}
 	else if(address < 0x4020) //Disabled APU and I/O Functionality
 		throw Unsupported("CPU Test Mode Disabled");
 	else //Cartridge Space
-		cart.writePRG(address, data);
+		writeCartridge(address, data);
+}
+
+uint8_t CPU::readCartridge(uint16_t address)
+{
+	return cart.readPRG(address);
+}
+
+void CPU::writeCartridge(uint16_t address, uint8_t data)
+{
+	//The PPU reads CHR straight from the mapper's banks and the DMC reads PRG, both have to be up to date before a write can
+	//switch them
+	syncPPU();
+	apu.runUntil(cycles);
+	cart.writePRG(address, data);
+}
+
+uint8_t CPU::read(uint16_t address)
+{
+	const uint8_t* page = readPages[address >> 8];
+	if(page)
+		return page[address & 0xFF];
+	return (this->*readHandlers[address >> 8])(address);
+}
+
+void CPU::write(uint16_t address, uint8_t data)
+{
+	uint8_t* page = writePages[address >> 8];
+	if(page)
+		page[address & 0xFF] = data;
+	else
+		(this->*writeHandlers[address >> 8])(address, data);
 }
 
 uint8_t CPU::pop()
@@ -148,19 +263,91 @@ void CPU::push(uint8_t data)
 
 void CPU::readOPCode()
 {
-	if(ppu.NMI())
+	if(cycles * 3 >= scheduler.nextTimestamp())
+		scheduler.dispatch(cycles * 3);
+
+	if(nmiLine)
+	{
+		nmiLine = false;
+		interruptVector = 0xFFFA;
+		cycleCount = 1;
+		tickFunction = &CPU::interrupt;
+		(this->*tickFunction)();
+	}
+	else if(apu.IRQ() && !(reg.SR & 0x04))
 	{
+		interruptVector = 0xFFFE;
 		cycleCount = 1;
-		tickFunction = std::bind(&CPU::NMI, this);
-		tickFunction();
+		tickFunction = &CPU::interrupt;
+		(this->*tickFunction)();
 	}
 	else
 	{
 		currentOP = read(reg.PC++);
 		cycleCount = 0;
+
+		if(trace)
+			traceInstruction();
 	}
 }
 
+void CPU::serialize(SaveState& state)
+{
+	state.field(reg);
+	state.block(RAM, sizeof(RAM));
+	state.field(oddCycle);
+	state.field(currentOP);
+	state.field(cycleCount);
+	state.field(dataBus);
+	state.field(addressBus);
+	state.field(totalCycles);
+	state.field(cycles);
+	state.field(dmaTransfer);
+	state.field(dmaTransferCycles);
+	state.field(cycleCountReturn);
+	state.field(dmaPage);
+	state.field(dmaLowByte);
+	state.field(dmaData);
+	state.field(nmiLine);
+
+	//Handlers can't be stored, but the only one that isn't the current opcode's is the interrupt sequence
+	bool inInterrupt = (tickFunction == &CPU::interrupt);
+	state.field(inInterrupt);
+	state.field(interruptVector);
+	if(state.isLoading())
+		tickFunction = inInterrupt ? &CPU::interrupt : opTable[currentOP];
+}
+
+void CPU::setTrace(Trace* trace)
+{
+	this->trace = trace;
+}
+
+void CPU::setProgramCounter(uint16_t address)
+{
+	//Discards the opcode that was already fetched and starts over at address, used to run nestest in automation mode
+	reg.PC = address;
+	readOPCode();
+}
+
+void CPU::traceInstruction()
+{
+	syncPPU();
+
+	TraceEntry entry;
+	entry.PC = reg.PC - 1;
+	entry.opcode = currentOP;
+	entry.A = reg.AC;
+	entry.X = reg.X;
+	entry.Y = reg.Y;
+	entry.P = reg.SR;
+	entry.SP = reg.SP;
+	entry.scanline = ppu.currentScanline();
+	entry.dot = ppu.currentDot();
+	entry.cycle = cycles;
+	trace->record(entry);
+}
+
 uint8_t CPU::readROM()
 {
 	uint8_t operand = read(reg.PC++);
@@ -266,7 +453,8 @@ void CPU::IRQ_BRK_Vector()
 	}
 }
 
-void CPU::implied(std::function<void()> executeInstruction)
+template<CPU::Operation executeInstruction>
+void CPU::implied()
 {
 	switch(cycleCount)
 	{
@@ -274,12 +462,13 @@ void CPU::implied(std::function<void()> executeInstruction)
 			read(reg.PC); //Dummy read
 			break;
 		case 2:
-			executeInstruction();
+			(this->*executeInstruction)();
 			readOPCode();
 	}
 }
 
-void CPU::immediate(std::function<void()> executeInstruction)
+template<CPU::Operation executeInstruction>
+void CPU::immediate()
 {
 	switch(cycleCount)
 	{
@@ -287,12 +476,13 @@ void CPU::immediate(std::function<void()> executeInstruction)
 			dataBus = readROM();
 			break;
 		case 2:
-			executeInstruction();
+			(this->*executeInstruction)();
 			readOPCode();
 	}
 }
 
-void CPU::zeroPage(std::function<void()> executeInstruction)
+template<CPU::Operation executeInstruction>
+void CPU::zeroPage()
 {
 	switch(cycleCount)
 	{
@@ -303,12 +493,13 @@ void CPU::zeroPage(std::function<void()> executeInstruction)
 			dataBus = read(addressBus);
 			break;
 		case 3:
-			executeInstruction();
+			(this->*executeInstruction)();
 			readOPCode();
 	}
 }
 
-void CPU::zeroPageIndexed(std::function<void()> executeInstruction, const uint8_t& index)
+template<CPU::Operation executeInstruction, CPU::Register index>
+void CPU::zeroPageIndexed()
 {
 	switch(cycleCount)
 	{
@@ -317,19 +508,20 @@ void CPU::zeroPageIndexed(std::function<void()> executeInstruction, const uint8_
 			break;
 		case 2:
 			read(dataBus); //Dummy read
-			dataBus += index;
+			dataBus += reg.*index;
 			addressBus = dataBus;
 			break;
 		case 3:
 			dataBus = read(addressBus);
 			break;
 		case 4:
-			executeInstruction();
+			(this->*executeInstruction)();
 			readOPCode();
 	}
 }
 
-void CPU::absolute(std::function<void()> executeInstruction)
+template<CPU::Operation executeInstruction>
+void CPU::absolute()
 {
 	switch(cycleCount)
 	{
@@ -343,12 +535,13 @@ void CPU::absolute(std::function<void()> executeInstruction)
 			dataBus = read(addressBus);
 			break;
 		case 4:
-			executeInstruction();
+			(this->*executeInstruction)();
 			readOPCode();
 	}
 }
 
-void CPU::absoluteIndexed(std::function<void()> executeInstruction, const uint8_t& index)
+template<CPU::Operation executeInstruction, CPU::Register index>
+void CPU::absoluteIndexed()
 {
 	switch(cycleCount)
 	{
@@ -356,7 +549,7 @@ void CPU::absoluteIndexed(std::function<void()> executeInstruction, const uint8_
 			dataBus = readROM();
 			break;
 		case 2:
-			addressBus = dataBus + index;
+			addressBus = dataBus + reg.*index;
 			dataBus = readROM();
 			break;
 		case 3:
@@ -374,12 +567,13 @@ void CPU::absoluteIndexed(std::function<void()> executeInstruction, const uint8_
 			dataBus = read(addressBus);
 			break;
 		case 5:
-			executeInstruction();
+			(this->*executeInstruction)();
 			readOPCode();
 	}
 }
 
-void CPU::indirectX(std::function<void()> executeInstruction)
+template<CPU::Operation executeInstruction>
+void CPU::indirectX()
 {
 	switch(cycleCount)
 	{
@@ -401,12 +595,13 @@ void CPU::indirectX(std::function<void()> executeInstruction)
 			dataBus = read(addressBus);
 			break;
 		case 6:
-			executeInstruction();
+			(this->*executeInstruction)();
 			readOPCode();
 	}
 }
 
-void CPU::indirectY(std::function<void()> executeInstruction)
+template<CPU::Operation executeInstruction>
+void CPU::indirectY()
 {
 	switch(cycleCount)
 	{
@@ -435,7 +630,7 @@ void CPU::indirectY(std::function<void()> executeInstruction)
 			dataBus = read(addressBus);
 			break;
 		case 6:
-			executeInstruction();
+			(this->*executeInstruction)();
 			readOPCode();
 	}
 }
@@ -453,7 +648,8 @@ uint16_t CPU::relativeAddress(uint8_t offset)
 	return reg.PC + signedOffset;
 }
 
-void CPU::relative(bool condition)
+template<CPU::Flag flag, bool condition>
+void CPU::relative()
 {
 	switch(cycleCount)
 	{
@@ -462,7 +658,7 @@ void CPU::relative(bool condition)
 			addressBus = relativeAddress(dataBus);
 			break;
 		case 2:
-			if(!condition)
+			if((this->*flag)() != condition)
 				readOPCode();
 			else
 				read((reg.PC & 0xFF00) + (addressBus & 0xFF)); //Dummy read
@@ -482,7 +678,8 @@ void CPU::relative(bool condition)
 	}
 }
 
-void CPU::zeroPage_Store(const uint8_t& regValue)
+template<CPU::Register regValue>
+void CPU::zeroPage_Store()
 {
 	switch(cycleCount)
 	{
@@ -490,14 +687,15 @@ void CPU::zeroPage_Store(const uint8_t& regValue)
 			addressBus = readROM();
 			break;
 		case 2:
-			write(addressBus, regValue);
+			write(addressBus, reg.*regValue);
 			break;
 		case 3:
 			readOPCode();
 	}
 }
 
-void CPU::zeroPageIndexed_Store(const uint8_t& regValue, const uint8_t& index)
+template<CPU::Register regValue, CPU::Register index>
+void CPU::zeroPageIndexed_Store()
 {
 	switch(cycleCount)
 	{
@@ -506,18 +704,19 @@ void CPU::zeroPageIndexed_Store(const uint8_t& regValue, const uint8_t& index)
 			break;
 		case 2:
 			read(addressBus); //Dummy read
-			dataBus += index;
+			dataBus += reg.*index;
 			addressBus = dataBus;
 			break;
 		case 3:
-			write(addressBus, regValue);
+			write(addressBus, reg.*regValue);
 			break;
 		case 4:
 			readOPCode();
 	}
 }
 
-void CPU::absolute_Store(const uint8_t& regValue)
+template<CPU::Register regValue>
+void CPU::absolute_Store()
 {
 	switch(cycleCount)
 	{
@@ -528,14 +727,15 @@ void CPU::absolute_Store(const uint8_t& regValue)
 			addressBus = (readROM() << 8) + addressBus;
 			break;
 		case 3:
-			write(addressBus, regValue);
+			write(addressBus, reg.*regValue);
 			break;
 		case 4:
 			readOPCode();
 	}
 }
 
-void CPU::absoluteIndexed_Store(const uint8_t& regValue, const uint8_t& index)
+template<CPU::Register regValue, CPU::Register index>
+void CPU::absoluteIndexed_Store()
 {
 	switch(cycleCount)
 	{
@@ -546,18 +746,19 @@ void CPU::absoluteIndexed_Store(const uint8_t& regValue, const uint8_t& index)
 			addressBus = (readROM() << 8) + addressBus;
 			break;
 		case 3:
-			read((addressBus & 0xFF00) + ((addressBus + index) & 0xFF)); //Dummy read
-			addressBus += index;
+			read((addressBus & 0xFF00) + ((addressBus + reg.*index) & 0xFF)); //Dummy read
+			addressBus += reg.*index;
 			break;
 		case 4:
-			write(addressBus, regValue);
+			write(addressBus, reg.*regValue);
 			break;
 		case 5:
 			readOPCode();
 	}
 }
 
-void CPU::indirectX_Store(const uint8_t& regValue)
+template<CPU::Register regValue>
+void CPU::indirectX_Store()
 {
 	switch(cycleCount)
 	{
@@ -576,14 +777,15 @@ void CPU::indirectX_Store(const uint8_t& regValue)
 			addressBus = (read(dataBus) << 8) + addressBus;
 			break;
 		case 5:
-			write(addressBus, regValue);
+			write(addressBus, reg.*regValue);
 			break;
 		case 6:
 			readOPCode();
 	}
 }
 
-void CPU::indirectY_Store(const uint8_t& regValue)
+template<CPU::Register regValue>
+void CPU::indirectY_Store()
 {
 	switch(cycleCount)
 	{
@@ -601,14 +803,15 @@ void CPU::indirectY_Store(const uint8_t& regValue)
 			addressBus += reg.Y;
 			break;
 		case 5:
-			write(addressBus, regValue);
+			write(addressBus, reg.*regValue);
 			break;
 		case 6:
 			readOPCode();
 	}
 }
 
-void CPU::accumulator(std::function<void()> executeInstruction)
+template<CPU::Operation executeInstruction>
+void CPU::accumulator()
 {
 	switch(cycleCount)
 	{
@@ -617,14 +820,15 @@ void CPU::accumulator(std::function<void()> executeInstruction)
 			dataBus = reg.AC;
 			break;
 		case 2:
-			executeInstruction();
+			(this->*executeInstruction)();
 			reg.AC = dataBus;
 			readOPCode();
 			break;
 	}
 }
 
-void CPU::zeroPage_RMW(std::function<void()> executeInstruction)
+template<CPU::Operation executeInstruction>
+void CPU::zeroPage_RMW()
 {
 	switch(cycleCount)
 	{
@@ -638,7 +842,7 @@ void CPU::zeroPage_RMW(std::function<void()> executeInstruction)
 			write(addressBus, 0xFF); //Write is performed here while data is being modified
 			break;
 		case 4:
-			executeInstruction();
+			(this->*executeInstruction)();
 			write(addressBus, dataBus);
 			break;
 		case 5:
@@ -646,7 +850,8 @@ void CPU::zeroPage_RMW(std::function<void()> executeInstruction)
 	}
 }
 
-void CPU::zeroPageX_RMW(std::function<void()> executeInstruction)
+template<CPU::Operation executeInstruction>
+void CPU::zeroPageX_RMW()
 {
 	switch(cycleCount)
 	{
@@ -665,7 +870,7 @@ void CPU::zeroPageX_RMW(std::function<void()> executeInstruction)
 			write(addressBus, 0xFF); //Write is performed here while data is being modified
 			break;
 		case 5:
-			executeInstruction();
+			(this->*executeInstruction)();
 			write(addressBus, dataBus);
 			break;
 		case 6:
@@ -673,7 +878,8 @@ void CPU::zeroPageX_RMW(std::function<void()> executeInstruction)
 	}
 }
 
-void CPU::absolute_RMW(std::function<void()> executeInstruction)
+template<CPU::Operation executeInstruction>
+void CPU::absolute_RMW()
 {
 	switch(cycleCount)
 	{
@@ -690,7 +896,7 @@ void CPU::absolute_RMW(std::function<void()> executeInstruction)
 			write(addressBus, 0xFF); //Write is performed here while data is being modified
 			break;
 		case 5:
-			executeInstruction();
+			(this->*executeInstruction)();
 			write(addressBus, dataBus);
 			break;
 		case 6:
@@ -698,7 +904,8 @@ void CPU::absolute_RMW(std::function<void()> executeInstruction)
 	}
 }
 
-void CPU::absoluteX_RMW(std::function<void()> executeInstruction)
+template<CPU::Operation executeInstruction>
+void CPU::absoluteX_RMW()
 {
 	switch(cycleCount)
 	{
@@ -720,7 +927,7 @@ void CPU::absoluteX_RMW(std::function<void()> executeInstruction)
 			write(addressBus, 0xFF); //Write is performed here while data is being modified
 			break;
 		case 6:
-			executeInstruction();
+			(this->*executeInstruction)();
 			write(addressBus, dataBus);
 			break;
 		case 7:
@@ -794,9 +1001,30 @@ void CPU::BRK()
 	}
 }
 
-void CPU::CMP(const uint8_t& regValue)
+void CPU::CLC()
+{
+	set_carry(false);
+}
+
+void CPU::CLD()
 {
-	uint16_t temp = regValue - dataBus;
+	set_decimal(false);
+}
+
+void CPU::CLI()
+{
+	set_interrupt(false);
+}
+
+void CPU::CLV()
+{
+	set_overflow(false);
+}
+
+template<CPU::Register regValue>
+void CPU::CMP()
+{
+	uint16_t temp = reg.*regValue - dataBus;
 	set_carry(temp < 0x100);
 	set_sign(temp);
 	set_zero(temp & 0xFF);
@@ -949,6 +1177,11 @@ void CPU::LSR()
 	set_zero(dataBus);
 }
 
+void CPU::NOP()
+{
+
+}
+
 void CPU::ORA()
 {
 	reg.AC |= dataBus;
@@ -1123,6 +1356,21 @@ void CPU::SBC()
 	reg.AC = (temp & 0xFF);
 }
 
+void CPU::SEC()
+{
+	set_carry(true);
+}
+
+void CPU::SED()
+{
+	set_decimal(true);
+}
+
+void CPU::SEI()
+{
+	set_interrupt(true);
+}
+
 void CPU::TAX()
 {
 	reg.X = reg.AC;
@@ -1163,586 +1411,178 @@ void CPU::TYA()
 	set_zero(reg.AC);
 }
 
+void CPU::unknownOP()
+{
+	throw UnkownOPCode(currentOP, cycleCount, totalCycles, reg.PC);
+}
+
+constexpr std::array<CPU::TickFunction, 256> CPU::buildOpTable()
+{
+	std::array<TickFunction, 256> table{};
+	for(TickFunction& entry : table)
+		entry = &CPU::unknownOP;
+
+	table[0x69] = &CPU::immediate<&CPU::ADC>;	//Immediate ADC
+	table[0x65] = &CPU::zeroPage<&CPU::ADC>;	//Zero Page ADC
+	table[0x75] = &CPU::zeroPageIndexed<&CPU::ADC, &CPU_Registers::X>;	//Zero Page,X ADC
+	table[0x6D] = &CPU::absolute<&CPU::ADC>;	//Absolute ADC
+	table[0x7D] = &CPU::absoluteIndexed<&CPU::ADC, &CPU_Registers::X>;	//Absolute,X ADC
+	table[0x79] = &CPU::absoluteIndexed<&CPU::ADC, &CPU_Registers::Y>;	//Absolute,Y ADC
+	table[0x61] = &CPU::indirectX<&CPU::ADC>;	//Indirect,X ADC
+	table[0x71] = &CPU::indirectY<&CPU::ADC>;	//Indirect,Y ADC
+	table[0x29] = &CPU::immediate<&CPU::AND>;	//Immediate AND
+	table[0x25] = &CPU::zeroPage<&CPU::AND>;	//Zero Page AND
+	table[0x35] = &CPU::zeroPageIndexed<&CPU::AND, &CPU_Registers::X>;	//Zero Page,X AND
+	table[0x2D] = &CPU::absolute<&CPU::AND>;	//Absolute AND
+	table[0x3D] = &CPU::absoluteIndexed<&CPU::AND, &CPU_Registers::X>;	//Absolute,X AND
+	table[0x39] = &CPU::absoluteIndexed<&CPU::AND, &CPU_Registers::Y>;	//Absolute,Y AND
+	table[0x21] = &CPU::indirectX<&CPU::AND>;	//Indirect,X AND
+	table[0x31] = &CPU::indirectY<&CPU::AND>;	//Indirect,Y AND
+	table[0x0A] = &CPU::accumulator<&CPU::ASL>;	//Accumulator ASL
+	table[0x06] = &CPU::zeroPage_RMW<&CPU::ASL>;	//Zero Page ASL
+	table[0x16] = &CPU::zeroPageX_RMW<&CPU::ASL>;	//Zero Page,X ASL
+	table[0x0E] = &CPU::absolute_RMW<&CPU::ASL>;	//Absolute ASL
+	table[0x1E] = &CPU::absoluteX_RMW<&CPU::ASL>;	//Absolute,X ASL
+	table[0x90] = &CPU::relative<&CPU::if_carry, false>;	//Relative BCC
+	table[0xB0] = &CPU::relative<&CPU::if_carry, true>;	//Relative BCS
+	table[0xF0] = &CPU::relative<&CPU::if_zero, true>;	//Relative BEQ
+	table[0x24] = &CPU::zeroPage<&CPU::BIT>;	//Zero Page BIT
+	table[0x2C] = &CPU::absolute<&CPU::BIT>;	//Absolute BIT
+	table[0x30] = &CPU::relative<&CPU::if_sign, true>;	//Relative BMI
+	table[0xD0] = &CPU::relative<&CPU::if_zero, false>;	//Relative BNE
+	table[0x10] = &CPU::relative<&CPU::if_sign, false>;	//Relative BPL
+	table[0x00] = &CPU::BRK;	//Implied BRK
+	table[0x50] = &CPU::relative<&CPU::if_overflow, false>;	//Relative BVC
+	table[0x70] = &CPU::relative<&CPU::if_overflow, true>;	//Relative BVS
+	table[0x18] = &CPU::implied<&CPU::CLC>;	//Implied CLC
+	table[0xD8] = &CPU::implied<&CPU::CLD>;	//Implied CLD
+	table[0x58] = &CPU::implied<&CPU::CLI>;	//Implied CLI
+	table[0xB8] = &CPU::implied<&CPU::CLV>;	//Implied CLV
+	table[0xC9] = &CPU::immediate<&CPU::CMP<&CPU_Registers::AC>>;	//Immediate CMP
+	table[0xC5] = &CPU::zeroPage<&CPU::CMP<&CPU_Registers::AC>>;	//Zero Page CMP
+	table[0xD5] = &CPU::zeroPageIndexed<&CPU::CMP<&CPU_Registers::AC>, &CPU_Registers::X>;	//Zero Page,X CMP
+	table[0xCD] = &CPU::absolute<&CPU::CMP<&CPU_Registers::AC>>;	//Absolute CMP
+	table[0xDD] = &CPU::absoluteIndexed<&CPU::CMP<&CPU_Registers::AC>, &CPU_Registers::X>;	//Absolute,X CMP
+	table[0xD9] = &CPU::absoluteIndexed<&CPU::CMP<&CPU_Registers::AC>, &CPU_Registers::Y>;	//Absolute,Y CMP
+	table[0xC1] = &CPU::indirectX<&CPU::CMP<&CPU_Registers::AC>>;	//Indirect,X CMP
+	table[0xD1] = &CPU::indirectY<&CPU::CMP<&CPU_Registers::AC>>;	//Indirect,Y CMP
+	table[0xE0] = &CPU::immediate<&CPU::CMP<&CPU_Registers::X>>;	//Immediate CPX
+	table[0xE4] = &CPU::zeroPage<&CPU::CMP<&CPU_Registers::X>>;	//Zero Page CPX
+	table[0xEC] = &CPU::absolute<&CPU::CMP<&CPU_Registers::X>>;	//Absolute CPX
+	table[0xC0] = &CPU::immediate<&CPU::CMP<&CPU_Registers::Y>>;	//Immediate CPY
+	table[0xC4] = &CPU::zeroPage<&CPU::CMP<&CPU_Registers::Y>>;	//Zero Page CPY
+	table[0xCC] = &CPU::absolute<&CPU::CMP<&CPU_Registers::Y>>;	//Absolute CPY
+	table[0xC6] = &CPU::zeroPage_RMW<&CPU::DEC>;	//Zero Page DEC
+	table[0xD6] = &CPU::zeroPageX_RMW<&CPU::DEC>;	//Zero Page, X DEC
+	table[0xCE] = &CPU::absolute_RMW<&CPU::DEC>;	//Absolute DEC
+	table[0xDE] = &CPU::absoluteX_RMW<&CPU::DEC>;	//Absolute,X DEC
+	table[0xCA] = &CPU::implied<&CPU::DEX>;	//Implied DEX
+	table[0x88] = &CPU::implied<&CPU::DEY>;	//Implied DEY
+	table[0x49] = &CPU::immediate<&CPU::EOR>;	//Immediate EOR
+	table[0x45] = &CPU::zeroPage<&CPU::EOR>;	//Zero Page EOR
+	table[0x55] = &CPU::zeroPageIndexed<&CPU::EOR, &CPU_Registers::X>;	//Zero Page,X EOR
+	table[0x4D] = &CPU::absolute<&CPU::EOR>;	//Absolute EOR
+	table[0x5D] = &CPU::absoluteIndexed<&CPU::EOR, &CPU_Registers::X>;	//Absolute,X EOR
+	table[0x59] = &CPU::absoluteIndexed<&CPU::EOR, &CPU_Registers::Y>;	//Absolute,Y EOR
+	table[0x41] = &CPU::indirectX<&CPU::EOR>;	//Indirect,X EOR
+	table[0x51] = &CPU::indirectY<&CPU::EOR>;	//Indrect,Y EOR
+	table[0xE6] = &CPU::zeroPage_RMW<&CPU::INC>;	//Zero Page INC
+	table[0xF6] = &CPU::zeroPageX_RMW<&CPU::INC>;	//Zero Page, X INC
+	table[0xEE] = &CPU::absolute_RMW<&CPU::INC>;	//Absolute INC
+	table[0xFE] = &CPU::absoluteX_RMW<&CPU::INC>;	//Absolute,X INC
+	table[0xE8] = &CPU::implied<&CPU::INX>;	//Implied INX
+	table[0xC8] = &CPU::implied<&CPU::INY>;	//Implied INY
+	table[0x4C] = &CPU::absoluteJMP;	//Absolute JMP
+	table[0x6C] = &CPU::indirectJMP;	//Indirect JMP
+	table[0x20] = &CPU::JSR;	//Absolute JSR
+	table[0xA9] = &CPU::immediate<&CPU::LDA>;	//Immediate LDA
+	table[0xA5] = &CPU::zeroPage<&CPU::LDA>;	//Zero Page LDA
+	table[0xB5] = &CPU::zeroPageIndexed<&CPU::LDA, &CPU_Registers::X>;	//Zero Page,X LDA
+	table[0xAD] = &CPU::absolute<&CPU::LDA>;	//Absolute LDA
+	table[0xBD] = &CPU::absoluteIndexed<&CPU::LDA, &CPU_Registers::X>;	//Absolute,X LDA
+	table[0xB9] = &CPU::absoluteIndexed<&CPU::LDA, &CPU_Registers::Y>;	//Absolute,Y LDA
+	table[0xA1] = &CPU::indirectX<&CPU::LDA>;	//Indirect,X LDA
+	table[0xB1] = &CPU::indirectY<&CPU::LDA>;	//Indirect,Y LDA
+	table[0xA2] = &CPU::immediate<&CPU::LDX>;	//Immediate LDX
+	table[0xA6] = &CPU::zeroPage<&CPU::LDX>;	//Zero Page LDX
+	table[0xB6] = &CPU::zeroPageIndexed<&CPU::LDX, &CPU_Registers::Y>;	//Zero Page,Y LDX
+	table[0xAE] = &CPU::absolute<&CPU::LDX>;	//Absolute LDX
+	table[0xBE] = &CPU::absoluteIndexed<&CPU::LDX, &CPU_Registers::Y>;	//Absolute,Y LDX
+	table[0xA0] = &CPU::immediate<&CPU::LDY>;	//Immediate LDY
+	table[0xA4] = &CPU::zeroPage<&CPU::LDY>;	//Zero Page LDY
+	table[0xB4] = &CPU::zeroPageIndexed<&CPU::LDY, &CPU_Registers::X>;	//Zero Page,X LDY
+	table[0xAC] = &CPU::absolute<&CPU::LDY>;	//Absolute LDY
+	table[0xBC] = &CPU::absoluteIndexed<&CPU::LDY, &CPU_Registers::X>;	//Absolute,X LDY
+	table[0x4A] = &CPU::accumulator<&CPU::LSR>;	//Accumulator LSR
+	table[0x46] = &CPU::zeroPage_RMW<&CPU::LSR>;	//Zero Page LSR
+	table[0x56] = &CPU::zeroPageX_RMW<&CPU::LSR>;	//Zero Page,X LSR
+	table[0x4E] = &CPU::absolute_RMW<&CPU::LSR>;	//Absolute LSR
+	table[0x5E] = &CPU::absoluteX_RMW<&CPU::LSR>;	//Absolute,X LSR
+	table[0xEA] = &CPU::implied<&CPU::NOP>;	//Implied NOP
+	table[0x09] = &CPU::immediate<&CPU::ORA>;	//Immediate ORA
+	table[0x05] = &CPU::zeroPage<&CPU::ORA>;	//Zero Page ORA
+	table[0x15] = &CPU::zeroPageIndexed<&CPU::ORA, &CPU_Registers::X>;	//Zero Page,X ORA
+	table[0x0D] = &CPU::absolute<&CPU::ORA>;	//Absolute ORA
+	table[0x1D] = &CPU::absoluteIndexed<&CPU::ORA, &CPU_Registers::X>;	//Absolute,X ORA
+	table[0x19] = &CPU::absoluteIndexed<&CPU::ORA, &CPU_Registers::Y>;	//Absolute,Y ORA
+	table[0x01] = &CPU::indirectX<&CPU::ORA>;	//Indirect,X ORA
+	table[0x11] = &CPU::indirectY<&CPU::ORA>;	//Indirect,Y ORA
+	table[0x48] = &CPU::PHA;	//Implied PHA
+	table[0x08] = &CPU::PHP;	//Implied PHP
+	table[0x68] = &CPU::PLA;	//Implied PLA
+	table[0x28] = &CPU::PLP;	//Implied PLP
+	table[0x2A] = &CPU::accumulator<&CPU::ROL>;	//Accumulator ROL
+	table[0x26] = &CPU::zeroPage_RMW<&CPU::ROL>;	//Zero Page ROL
+	table[0x36] = &CPU::zeroPageX_RMW<&CPU::ROL>;	//Zero Page,X ROL
+	table[0x2E] = &CPU::absolute_RMW<&CPU::ROL>;	//Absolute ROL
+	table[0x3E] = &CPU::absoluteX_RMW<&CPU::ROL>;	//Absolute,X ROL
+	table[0x6A] = &CPU::accumulator<&CPU::ROR>;	//Accumulator ROR
+	table[0x66] = &CPU::zeroPage_RMW<&CPU::ROR>;	//Zero Page ROR
+	table[0x76] = &CPU::zeroPageX_RMW<&CPU::ROR>;	//Zero Page,X ROR
+	table[0x6E] = &CPU::absolute_RMW<&CPU::ROR>;	//Absolute ROR
+	table[0x7E] = &CPU::absoluteX_RMW<&CPU::ROR>;	//Absolute,X ROR
+	table[0x40] = &CPU::RTI;	//Implied RTI
+	table[0x60] = &CPU::RTS;	//Implied RTS
+	table[0xE9] = &CPU::immediate<&CPU::SBC>;	//Immediate SBC
+	table[0xE5] = &CPU::zeroPage<&CPU::SBC>;	//Zero Page SBC
+	table[0xF5] = &CPU::zeroPageIndexed<&CPU::SBC, &CPU_Registers::X>;	//Zero Page,X SBC
+	table[0xED] = &CPU::absolute<&CPU::SBC>;	//Absolute SBC
+	table[0xFD] = &CPU::absoluteIndexed<&CPU::SBC, &CPU_Registers::X>;	//Absolute,X SBC
+	table[0xF9] = &CPU::absoluteIndexed<&CPU::SBC, &CPU_Registers::Y>;	//Absolute,Y SBC
+	table[0xE1] = &CPU::indirectX<&CPU::SBC>;	//Indirect,X SBC
+	table[0xF1] = &CPU::indirectY<&CPU::SBC>;	//Indirect,Y SBC
+	table[0x38] = &CPU::implied<&CPU::SEC>;	//Implied SEC
+	table[0xF8] = &CPU::implied<&CPU::SED>;	//Implied SED
+	table[0x78] = &CPU::implied<&CPU::SEI>;	//Implied SEI
+	table[0x85] = &CPU::zeroPage_Store<&CPU_Registers::AC>;	//Zero Page STA
+	table[0x95] = &CPU::zeroPageIndexed_Store<&CPU_Registers::AC, &CPU_Registers::X>;	//Zero Page,X STA
+	table[0x8D] = &CPU::absolute_Store<&CPU_Registers::AC>;	//Absolute STA
+	table[0x9D] = &CPU::absoluteIndexed_Store<&CPU_Registers::AC, &CPU_Registers::X>;	//Absolute,X STA
+	table[0x99] = &CPU::absoluteIndexed_Store<&CPU_Registers::AC, &CPU_Registers::Y>;	//Absolute,Y STA
+	table[0x81] = &CPU::indirectX_Store<&CPU_Registers::AC>;	//Indirect,X STA
+	table[0x91] = &CPU::indirectY_Store<&CPU_Registers::AC>;	//Indirect,Y STA
+	table[0x86] = &CPU::zeroPage_Store<&CPU_Registers::X>;	//Zero Page STX
+	table[0x96] = &CPU::zeroPageIndexed_Store<&CPU_Registers::X, &CPU_Registers::Y>;	//Zero Page,Y STX
+	table[0x8E] = &CPU::absolute_Store<&CPU_Registers::X>;	//Absolute STX
+	table[0x84] = &CPU::zeroPage_Store<&CPU_Registers::Y>;	//Zero Page STY
+	table[0x94] = &CPU::zeroPageIndexed_Store<&CPU_Registers::Y, &CPU_Registers::X>;	//Zero Page,X STY
+	table[0x8C] = &CPU::absolute_Store<&CPU_Registers::Y>;	//Absolute STY
+	table[0xAA] = &CPU::implied<&CPU::TAX>;	//Implied TAX
+	table[0xA8] = &CPU::implied<&CPU::TAY>;	//Implied TAY
+	table[0xBA] = &CPU::implied<&CPU::TSX>;	//Implied TSX
+	table[0x8A] = &CPU::implied<&CPU::TXA>;	//Implied TXA
+	table[0x9A] = &CPU::implied<&CPU::TXS>;	//Implied TXS
+	table[0x98] = &CPU::implied<&CPU::TYA>;	//Implied TYA
+
+	return table;
+}
+
+//Defined constexpr so the table has to be built by the compiler, static initialization never runs for it. The class can't
+//say so itself since buildOpTable() isn't defined yet where opTable is declared
+constexpr std::array<CPU::TickFunction, 256> CPU::opTable = CPU::buildOpTable();
+
 void CPU::decodeOP()
 {
-	std::function<void()> executeInstruction;
-	switch(currentOP)
-	{
-		case 0x69:	//Immediate ADC
-			executeInstruction = std::bind(&CPU::ADC, this);
-			tickFunction = std::bind(&CPU::immediate, this, executeInstruction);
-			break;
-		case 0x65: //Zero Page ADC
-			executeInstruction = std::bind(&CPU::ADC, this);
-			tickFunction = std::bind(&CPU::zeroPage, this, executeInstruction);
-			break;
-		case 0x75: //Zero Page,X ADC
-			executeInstruction = std::bind(&CPU::ADC, this);
-			tickFunction = std::bind(&CPU::zeroPageIndexed, this, executeInstruction, reg.X);
-			break;
-		case 0x6D: //Absolute ADC
-			executeInstruction = std::bind(&CPU::ADC, this);
-			tickFunction = std::bind(&CPU::absolute, this, executeInstruction);
-			break;
-		case 0x7D: //Absolute,X ADC
-			executeInstruction = std::bind(&CPU::ADC, this);
-			tickFunction = std::bind(&CPU::absoluteIndexed, this, executeInstruction, reg.X);
-			break;
-		case 0x79: //Absolute,Y ADC
-			executeInstruction = std::bind(&CPU::ADC, this);
-			tickFunction = std::bind(&CPU::absoluteIndexed, this, executeInstruction, reg.Y);
-			break;
-		case 0x61: //Indirect,X ADC
-			executeInstruction = std::bind(&CPU::ADC, this);
-			tickFunction = std::bind(&CPU::indirectX, this, executeInstruction);
-			break;
-		case 0x71: //Indirect,Y ADC
-			executeInstruction = std::bind(&CPU::ADC, this);
-			tickFunction = std::bind(&CPU::indirectY, this, executeInstruction);
-			break;
-		case 0x29: //Immediate AND
-			executeInstruction = std::bind(&CPU::AND, this);
-			tickFunction = std::bind(&CPU::immediate, this, executeInstruction);
-			break;
-		case 0x25: //Zero Page AND
-			executeInstruction = std::bind(&CPU::AND, this);
-			tickFunction = std::bind(&CPU::zeroPage, this, executeInstruction);
-			break;
-		case 0x35: //Zero Page,X AND
-			executeInstruction = std::bind(&CPU::AND, this);
-			tickFunction = std::bind(&CPU::zeroPageIndexed, this, executeInstruction, reg.X);
-			break;
-		case 0x2D: //Absolute AND
-			executeInstruction = std::bind(&CPU::AND, this);
-			tickFunction = std::bind(&CPU::absolute, this, executeInstruction);
-			break;
-		case 0x3D: //Absolute,X AND
-			executeInstruction = std::bind(&CPU::AND, this);
-			tickFunction = std::bind(&CPU::absoluteIndexed, this, executeInstruction, reg.X);
-			break;
-		case 0x39: //Absolute,Y AND
-			executeInstruction = std::bind(&CPU::AND, this);
-			tickFunction = std::bind(&CPU::absoluteIndexed, this, executeInstruction, reg.Y);
-			break;
-		case 0x21: //Indirect,X AND
-			executeInstruction = std::bind(&CPU::AND, this);
-			tickFunction = std::bind(&CPU::indirectX, this, executeInstruction);
-			break;
-		case 0x31: //Indirect,Y AND
-			executeInstruction = std::bind(&CPU::AND, this);
-			tickFunction = std::bind(&CPU::indirectY, this, executeInstruction);
-			break;
-		case 0x0A: //Accumulator ASL
-			executeInstruction = std::bind(&CPU::ASL, this);
-			tickFunction = std::bind(&CPU::accumulator, this, executeInstruction);
-			break;
-		case 0x06: //Zero Page ASL
-			executeInstruction = std::bind(&CPU::ASL, this);
-			tickFunction = std::bind(&CPU::zeroPage_RMW, this, executeInstruction);
-			break;
-		case 0x16: //Zero Page,X ASL
-			executeInstruction = std::bind(&CPU::ASL, this);
-			tickFunction = std::bind(&CPU::zeroPageX_RMW, this, executeInstruction);
-			break;
-		case 0x0E: //Absolute ASL
-			executeInstruction = std::bind(&CPU::ASL, this);
-			tickFunction = std::bind(&CPU::absolute_RMW, this, executeInstruction);
-			break;
-		case 0x1E: //Absolute,X ASL
-			executeInstruction = std::bind(&CPU::ASL, this);
-			tickFunction = std::bind(&CPU::absoluteX_RMW, this, executeInstruction);
-			break;
-		case 0x90: //Relative BCC
-			tickFunction = std::bind(&CPU::relative, this, !if_carry());
-			break;
-		case 0xB0: //Relative BCS
-			tickFunction = std::bind(&CPU::relative, this, if_carry());
-			break;
-		case 0xF0: //Relative BEQ
-			tickFunction = std::bind(&CPU::relative, this, if_zero());
-			break;
-		case 0x24: //Zero Page BIT
-			executeInstruction = std::bind(&CPU::BIT, this);
-			tickFunction = std::bind(&CPU::zeroPage, this, executeInstruction);
-			break;
-		case 0x2C: //Absolute BIT
-			executeInstruction = std::bind(&CPU::BIT, this);
-			tickFunction = std::bind(&CPU::absolute, this, executeInstruction);
-			break;
-		case 0x30: //Relative BMI
-			tickFunction = std::bind(&CPU::relative, this, if_sign());
-			break;
-		case 0xD0: //Relative BNE
-			tickFunction = std::bind(&CPU::relative, this, !if_zero());
-			break;
-		case 0x10: //Relative BPL
-			tickFunction = std::bind(&CPU::relative, this, !if_sign());
-			break;
-		case 0x00: //Implied BRK
-			tickFunction = std::bind(&CPU::BRK, this);
-			break;
-		case 0x50: //Relative BVC
-			tickFunction = std::bind(&CPU::relative, this, !if_overflow());
-			break;
-		case 0x70: //Relative BVS
-			tickFunction = std::bind(&CPU::relative, this, if_overflow());
-			break;
-		case 0x18: //Implied CLC
-			executeInstruction = std::bind(&CPU::set_carry, this, 0);
-			tickFunction = std::bind(&CPU::implied, this, executeInstruction);
-			break;
-		case 0xD8: //Implied CLD
-			executeInstruction = std::bind(&CPU::set_decimal, this, 0);
-			tickFunction = std::bind(&CPU::implied, this, executeInstruction);
-			break;
-		case 0x58: //Implied CLI
-			executeInstruction = std::bind(&CPU::set_interrupt, this, 0);
-			tickFunction = std::bind(&CPU::implied, this, executeInstruction);
-			break;
-		case 0xB8: //Implied CLV
-			executeInstruction = std::bind(&CPU::set_overflow, this, 0);
-			tickFunction = std::bind(&CPU::implied, this, executeInstruction);
-			break;
-		case 0xC9: //Immediate CMP
-			executeInstruction = std::bind(&CPU::CMP, this, reg.AC);
-			tickFunction = std::bind(&CPU::immediate, this, executeInstruction);
-			break;
-		case 0xC5: //Zero Page CMP
-			executeInstruction = std::bind(&CPU::CMP, this, reg.AC);
-			tickFunction = std::bind(&CPU::zeroPage, this, executeInstruction);
-			break;
-		case 0xD5: //Zero Page,X CMP
-			executeInstruction = std::bind(&CPU::CMP, this, reg.AC);
-			tickFunction = std::bind(&CPU::zeroPageIndexed, this, executeInstruction, reg.X);
-			break;
-		case 0xCD: //Absolute CMP
-			executeInstruction = std::bind(&CPU::CMP, this, reg.AC);
-			tickFunction = std::bind(&CPU::absolute, this, executeInstruction);
-			break;
-		case 0xDD: //Absolute,X CMP
-			executeInstruction = std::bind(&CPU::CMP, this, reg.AC);
-			tickFunction = std::bind(&CPU::absoluteIndexed, this, executeInstruction, reg.X);
-			break;
-		case 0xD9: //Absolute,Y CMP
-			executeInstruction = std::bind(&CPU::CMP, this, reg.AC);
-			tickFunction = std::bind(&CPU::absoluteIndexed, this, executeInstruction, reg.Y);
-			break;
-		case 0xC1: //Indirect,X CMP
-			executeInstruction = std::bind(&CPU::CMP, this, reg.AC);
-			tickFunction = std::bind(&CPU::indirectX, this, executeInstruction);
-			break;
-		case 0xD1: //Indirect,Y CMP
-			executeInstruction = std::bind(&CPU::CMP, this, reg.AC);
-			tickFunction = std::bind(&CPU::indirectY, this, executeInstruction);
-			break;
-		case 0xE0: //Immediate CPX
-			executeInstruction = std::bind(&CPU::CMP, this, reg.X);
-			tickFunction = std::bind(&CPU::immediate, this, executeInstruction);
-			break;
-		case 0xE4: //Zero Page CPX
-			executeInstruction = std::bind(&CPU::CMP, this, reg.X);
-			tickFunction = std::bind(&CPU::zeroPage, this, executeInstruction);
-			break;
-		case 0xEC: //Absolute CPX
-			executeInstruction = std::bind(&CPU::CMP, this, reg.X);
-			tickFunction = std::bind(&CPU::absolute, this, executeInstruction);
-			break;
-		case 0xC0: //Immediate CPY
-			executeInstruction = std::bind(&CPU::CMP, this, reg.Y);
-			tickFunction = std::bind(&CPU::immediate, this, executeInstruction);
-			break;
-		case 0xC4: //Zero Page CPY
-			executeInstruction = std::bind(&CPU::CMP, this, reg.Y);
-			tickFunction = std::bind(&CPU::zeroPage, this, executeInstruction);
-			break;
-		case 0xCC: //Absolute CPY
-			executeInstruction = std::bind(&CPU::CMP, this, reg.Y);
-			tickFunction = std::bind(&CPU::absolute, this, executeInstruction);
-			break;
-		case 0xC6: //Zero Page DEC
-			executeInstruction = std::bind(&CPU::DEC, this);
-			tickFunction = std::bind(&CPU::zeroPage_RMW, this, executeInstruction);
-			break;
-		case 0xD6: //Zero Page, X DEC
-			executeInstruction = std::bind(&CPU::DEC, this);
-			tickFunction = std::bind(&CPU::zeroPageX_RMW, this, executeInstruction);
-			break;
-		case 0xCE: //Absolute DEC
-			executeInstruction = std::bind(&CPU::DEC, this);
-			tickFunction = std::bind(&CPU::absolute_RMW, this, executeInstruction);
-			break;
-		case 0xDE: //Absolute,X DEC
-			executeInstruction = std::bind(&CPU::DEC, this);
-			tickFunction = std::bind(&CPU::absoluteX_RMW, this, executeInstruction);
-			break;
-		case 0xCA: //Implied DEX
-			executeInstruction = std::bind(&CPU::DEX, this);
-			tickFunction = std::bind(&CPU::implied, this, executeInstruction);
-			break;
-		case 0x88: //Implied DEY
-			executeInstruction = std::bind(&CPU::DEY, this);
-			tickFunction = std::bind(&CPU::implied, this, executeInstruction);
-			break;
-		case 0x49: //Immediate EOR
-			executeInstruction = std::bind(&CPU::EOR, this);
-			tickFunction = std::bind(&CPU::immediate, this, executeInstruction);
-			break;
-		case 0x45: //Zero Page EOR
-			executeInstruction = std::bind(&CPU::EOR, this);
-			tickFunction = std::bind(&CPU::zeroPage, this, executeInstruction);
-			break;
-		case 0x55: //Zero Page,X EOR
-			executeInstruction = std::bind(&CPU::EOR, this);
-			tickFunction = std::bind(&CPU::zeroPageIndexed, this, executeInstruction, reg.X);
-			break;
-		case 0x4D: //Absolute EOR
-			executeInstruction = std::bind(&CPU::EOR, this);
-			tickFunction = std::bind(&CPU::absolute, this, executeInstruction);
-			break;
-		case 0x5D: //Absolute,X EOR
-			executeInstruction = std::bind(&CPU::EOR, this);
-			tickFunction = std::bind(&CPU::absoluteIndexed, this, executeInstruction, reg.X);
-			break;
-		case 0x59: //Absolute,Y EOR
-			executeInstruction = std::bind(&CPU::EOR, this);
-			tickFunction = std::bind(&CPU::absoluteIndexed, this, executeInstruction, reg.Y);
-			break;
-		case 0x41: //Indirect,X EOR
-			executeInstruction = std::bind(&CPU::EOR, this);
-			tickFunction = std::bind(&CPU::indirectX, this, executeInstruction);
-			break;
-		case 0x51: //Indrect,Y EOR
-			executeInstruction = std::bind(&CPU::EOR, this);
-			tickFunction = std::bind(&CPU::indirectY, this, executeInstruction);
-			break;
-		case 0xE6: //Zero Page INC
-			executeInstruction = std::bind(&CPU::INC, this);
-			tickFunction = std::bind(&CPU::zeroPage_RMW, this, executeInstruction);
-			break;
-		case 0xF6: //Zero Page, X INC
-			executeInstruction = std::bind(&CPU::INC, this);
-			tickFunction = std::bind(&CPU::zeroPageX_RMW, this, executeInstruction);
-			break;
-		case 0xEE: //Absolute INC
-			executeInstruction = std::bind(&CPU::INC, this);
-			tickFunction = std::bind(&CPU::absolute_RMW, this, executeInstruction);
-			break;
-		case 0xFE: //Absolute,X INC
-			executeInstruction = std::bind(&CPU::INC, this);
-			tickFunction = std::bind(&CPU::absoluteX_RMW, this, executeInstruction);
-			break;
-		case 0xE8: //Implied INX
-			executeInstruction = std::bind(&CPU::INX, this);
-			tickFunction = std::bind(&CPU::implied, this, executeInstruction);
-			break;
-		case 0xC8: //Implied INY
-			executeInstruction = std::bind(&CPU::INY, this);
-			tickFunction = std::bind(&CPU::implied, this, executeInstruction);
-			break;
-		case 0x4C: //Absolute JMP
-			tickFunction = std::bind(&CPU::absoluteJMP, this);
-			break;
-		case 0x6C: //Indirect JMP
-			tickFunction = std::bind(&CPU::indirectJMP, this);
-			break;
-		case 0x20: //Absolute JSR
-			tickFunction = std::bind(&CPU::JSR, this);
-			break;
-		case 0xA9: //Immediate LDA
-			executeInstruction = std::bind(&CPU::LDA, this);
-			tickFunction = std::bind(&CPU::immediate, this, executeInstruction);
-			break;
-		case 0xA5: //Zero Page LDA
-			executeInstruction = std::bind(&CPU::LDA, this);
-			tickFunction = std::bind(&CPU::zeroPage, this, executeInstruction);
-			break;
-		case 0xB5: //Zero Page,X LDA
-			executeInstruction = std::bind(&CPU::LDA, this);
-			tickFunction = std::bind(&CPU::zeroPageIndexed, this, executeInstruction, reg.X);
-			break;
-		case 0xAD: //Absolute LDA
-			executeInstruction = std::bind(&CPU::LDA, this);
-			tickFunction = std::bind(&CPU::absolute, this, executeInstruction);
-			break;
-		case 0xBD: //Absolute,X LDA
-			executeInstruction = std::bind(&CPU::LDA, this);
-			tickFunction = std::bind(&CPU::absoluteIndexed, this, executeInstruction, reg.X);
-			break;
-		case 0xB9: //Absolute,Y LDA
-			executeInstruction = std::bind(&CPU::LDA, this);
-			tickFunction = std::bind(&CPU::absoluteIndexed, this, executeInstruction, reg.Y);
-			break;
-		case 0xA1: //Indirect,X LDA
-			executeInstruction = std::bind(&CPU::LDA, this);
-			tickFunction = std::bind(&CPU::indirectX, this, executeInstruction);
-			break;
-		case 0xB1: //Indirect,Y LDA
-			executeInstruction = std::bind(&CPU::LDA, this);
-			tickFunction = std::bind(&CPU::indirectY, this, executeInstruction);
-			break;
-		case 0xA2: //Immediate LDX
-			executeInstruction = std::bind(&CPU::LDX, this);
-			tickFunction = std::bind(&CPU::immediate, this, executeInstruction);
-			break;
-		case 0xA6: //Zero Page LDX
-			executeInstruction = std::bind(&CPU::LDX, this);
-			tickFunction = std::bind(&CPU::zeroPage, this, executeInstruction);
-			break;
-		case 0xB6: //Zero Page,Y LDX
-			executeInstruction = std::bind(&CPU::LDX, this);
-			tickFunction = std::bind(&CPU::zeroPageIndexed, this, executeInstruction, reg.Y);
-			break;
-		case 0xAE: //Absolute LDX
-			executeInstruction = std::bind(&CPU::LDX, this);
-			tickFunction = std::bind(&CPU::absolute, this, executeInstruction);
-			break;
-		case 0xBE: //Absolute,Y LDX
-			executeInstruction = std::bind(&CPU::LDX, this);
-			tickFunction = std::bind(&CPU::absoluteIndexed, this, executeInstruction, reg.Y);
-			break;
-		case 0xA0: //Immediate LDY
-			executeInstruction = std::bind(&CPU::LDY, this);
-			tickFunction = std::bind(&CPU::immediate, this, executeInstruction);
-			break;
-		case 0xA4: //Zero Page LDY
-			executeInstruction = std::bind(&CPU::LDY, this);
-			tickFunction = std::bind(&CPU::zeroPage, this, executeInstruction);
-			break;
-		case 0xB4: //Zero Page,X LDY
-			executeInstruction = std::bind(&CPU::LDY, this);
-			tickFunction = std::bind(&CPU::zeroPageIndexed, this, executeInstruction, reg.X);
-			break;
-		case 0xAC: //Absolute LDY
-			executeInstruction = std::bind(&CPU::LDY, this);
-			tickFunction = std::bind(&CPU::absolute, this, executeInstruction);
-			break;
-		case 0xBC: //Absolute,X LDY
-			executeInstruction = std::bind(&CPU::LDY, this);
-			tickFunction = std::bind(&CPU::absoluteIndexed, this, executeInstruction, reg.X);
-			break;
-		case 0x4A: //Accumulator LSR
-			executeInstruction = std::bind(&CPU::LSR, this);
-			tickFunction = std::bind(&CPU::accumulator, this, executeInstruction);
-			break;
-		case 0x46: //Zero Page LSR
-			executeInstruction = std::bind(&CPU::LSR, this);
-			tickFunction = std::bind(&CPU::zeroPage_RMW, this, executeInstruction);
-			break;
-		case 0x56: //Zero Page,X LSR
-			executeInstruction = std::bind(&CPU::LSR, this);
-			tickFunction = std::bind(&CPU::zeroPageX_RMW, this, executeInstruction);
-			break;
-		case 0x4E: //Absolute LSR
-			executeInstruction = std::bind(&CPU::LSR, this);
-			tickFunction = std::bind(&CPU::absolute_RMW, this, executeInstruction);
-			break;
-		case 0x5E: //Absolute,X LSR
-			executeInstruction = std::bind(&CPU::LSR, this);
-			tickFunction = std::bind(&CPU::absoluteX_RMW, this, executeInstruction);
-			break;
-		case 0xEA: //Implied NOP
-			executeInstruction = [](){};
-			tickFunction = std::bind(&CPU::implied, this, executeInstruction);
-			break;
-		case 0x09: //Immediate ORA
-			executeInstruction = std::bind(&CPU::ORA, this);
-			tickFunction = std::bind(&CPU::immediate, this, executeInstruction);
-			break;
-		case 0x05: //Zero Page ORA
-			executeInstruction = std::bind(&CPU::ORA, this);
-			tickFunction = std::bind(&CPU::zeroPage, this, executeInstruction);
-			break;
-		case 0x15: //Zero Page,X ORA
-			executeInstruction = std::bind(&CPU::ORA, this);
-			tickFunction = std::bind(&CPU::zeroPageIndexed, this, executeInstruction, reg.X);
-			break;
-		case 0x0D: //Absolute ORA
-			executeInstruction = std::bind(&CPU::ORA, this);
-			tickFunction = std::bind(&CPU::absolute, this, executeInstruction);
-			break;
-		case 0x1D: //Absolute,X ORA
-			executeInstruction = std::bind(&CPU::ORA, this);
-			tickFunction = std::bind(&CPU::absoluteIndexed, this, executeInstruction, reg.X);
-			break;
-		case 0x19: //Absolute,Y ORA
-			executeInstruction = std::bind(&CPU::ORA, this);
-			tickFunction = std::bind(&CPU::absoluteIndexed, this, executeInstruction, reg.Y);
-			break;
-		case 0x01: //Indirect,X ORA
-			executeInstruction = std::bind(&CPU::ORA, this);
-			tickFunction = std::bind(&CPU::indirectX, this, executeInstruction);
-			break;
-		case 0x11: //Indirect,Y ORA
-			executeInstruction = std::bind(&CPU::ORA, this);
-			tickFunction = std::bind(&CPU::indirectY, this, executeInstruction);
-			break;
-		case 0x48: //Implied PHA
-			tickFunction = std::bind(&CPU::PHA, this);
-			break;
-		case 0x08: //Implied PHP
-			tickFunction = std::bind(&CPU::PHP, this);
-			break;
-		case 0x68: //Implied PLA
-			tickFunction = std::bind(&CPU::PLA, this);
-			break;
-		case 0x28: //Implied PLP
-			tickFunction = std::bind(&CPU::PLP, this);
-			break;
-		case 0x2A: //Accumulator ROL
-			executeInstruction = std::bind(&CPU::ROL, this);
-			tickFunction = std::bind(&CPU::accumulator, this, executeInstruction);
-			break;
-		case 0x26: //Zero Page ROL
-			executeInstruction = std::bind(&CPU::ROL, this);
-			tickFunction = std::bind(&CPU::zeroPage_RMW, this, executeInstruction);
-			break;
-		case 0x36: //Zero Page,X ROL
-			executeInstruction = std::bind(&CPU::ROL, this);
-			tickFunction = std::bind(&CPU::zeroPageX_RMW, this, executeInstruction);
-			break;
-		case 0x2E: //Absolute ROL
-			executeInstruction = std::bind(&CPU::ROL, this);
-			tickFunction = std::bind(&CPU::absolute_RMW, this, executeInstruction);
-			break;
-		case 0x3E: //Absolute,X ROL
-			executeInstruction = std::bind(&CPU::ROL, this);
-			tickFunction = std::bind(&CPU::absoluteX_RMW, this, executeInstruction);
-			break;
-		case 0x6A: //Accumulator ROR
-			executeInstruction = std::bind(&CPU::ROR, this);
-			tickFunction = std::bind(&CPU::accumulator, this, executeInstruction);
-			break;
-		case 0x66: //Zero Page ROR
-			executeInstruction = std::bind(&CPU::ROR, this);
-			tickFunction = std::bind(&CPU::zeroPage_RMW, this, executeInstruction);
-			break;
-		case 0x76: //Zero Page,X ROR
-			executeInstruction = std::bind(&CPU::ROR, this);
-			tickFunction = std::bind(&CPU::zeroPageX_RMW, this, executeInstruction);
-			break;
-		case 0x6E: //Absolute ROR
-			executeInstruction = std::bind(&CPU::ROR, this);
-			tickFunction = std::bind(&CPU::absolute_RMW, this, executeInstruction);
-			break;
-		case 0x7E: //Absolute,X ROR
-			executeInstruction = std::bind(&CPU::ROR, this);
-			tickFunction = std::bind(&CPU::absoluteX_RMW, this, executeInstruction);
-			break;
-		case 0x40: //Implied RTI
-			tickFunction = std::bind(&CPU::RTI, this);
-			break;
-		case 0x60: //Implied RTS
-			tickFunction = std::bind(&CPU::RTS, this);
-			break;
-		case 0xE9: //Immediate SBC
-			executeInstruction = std::bind(&CPU::SBC, this);
-			tickFunction = std::bind(&CPU::immediate, this, executeInstruction);
-			break;
-		case 0xE5: //Zero Page SBC
-			executeInstruction = std::bind(&CPU::SBC, this);
-			tickFunction = std::bind(&CPU::zeroPage, this, executeInstruction);
-			break;
-		case 0xF5: //Zero Page,X SBC
-			executeInstruction = std::bind(&CPU::SBC, this);
-			tickFunction = std::bind(&CPU::zeroPageIndexed, this, executeInstruction, reg.X);
-			break;
-		case 0xED: //Absolute SBC
-			executeInstruction = std::bind(&CPU::SBC, this);
-			tickFunction = std::bind(&CPU::absolute, this, executeInstruction);
-			break;
-		case 0xFD: //Absolute,X SBC
-			executeInstruction = std::bind(&CPU::SBC, this);
-			tickFunction = std::bind(&CPU::absoluteIndexed, this, executeInstruction, reg.X);
-			break;
-		case 0xF9: //Absolute,Y SBC
-			executeInstruction = std::bind(&CPU::SBC, this);
-			tickFunction = std::bind(&CPU::absoluteIndexed, this, executeInstruction, reg.Y);
-			break;
-		case 0xE1: //Indirect,X SBC
-			executeInstruction = std::bind(&CPU::SBC, this);
-			tickFunction = std::bind(&CPU::indirectX, this, executeInstruction);
-			break;
-		case 0xF1: //Indirect,Y SBC
-			executeInstruction = std::bind(&CPU::SBC, this);
-			tickFunction = std::bind(&CPU::indirectY, this, executeInstruction);
-			break;
-		case 0x38: //Implied SEC
-			executeInstruction = std::bind(&CPU::set_carry, this, 1);
-			tickFunction = std::bind(&CPU::implied, this, executeInstruction);
-			break;
-		case 0xF8: //Implied SED
-			executeInstruction = std::bind(&CPU::set_decimal, this, 1);
-			tickFunction = std::bind(&CPU::implied, this, executeInstruction);
-			break;
-		case 0x78: //Implied SEI
-			executeInstruction = std::bind(&CPU::set_interrupt, this, 1);
-			tickFunction = std::bind(&CPU::implied, this, executeInstruction);
-			break;
-		case 0x85: //Zero Page STA
-			tickFunction = std::bind(&CPU::zeroPage_Store, this, reg.AC);
-			break;
-		case 0x95: //Zero Page,X STA
-			tickFunction = std::bind(&CPU::zeroPageIndexed_Store, this, reg.AC, reg.X);
-			break;
-		case 0x8D: //Absolute STA
-			tickFunction = std::bind(&CPU::absolute_Store, this, reg.AC);
-			break;
-		case 0x9D: //Absolute,X STA
-			tickFunction = std::bind(&CPU::absoluteIndexed_Store, this, reg.AC, reg.X);
-			break;
-		case 0x99: //Absolute,Y STA
-			tickFunction = std::bind(&CPU::absoluteIndexed_Store, this, reg.AC, reg.Y);
-			break;
-		case 0x81: //Indirect,X STA
-			tickFunction = std::bind(&CPU::indirectX_Store, this, reg.AC);
-			break;
-		case 0x91: //Indirect,Y STA
-			tickFunction = std::bind(&CPU::indirectY_Store, this, reg.AC);
-			break;
-		case 0x86: //Zero Page STX
-			tickFunction = std::bind(&CPU::zeroPage_Store, this, reg.X);
-			break;
-		case 0x96: //Zero Page,Y STX
-			tickFunction = std::bind(&CPU::zeroPageIndexed_Store, this, reg.X, reg.Y);
-			break;
-		case 0x8E: //Absolute STX
-			tickFunction = std::bind(&CPU::absolute_Store, this, reg.X);
-			break;
-		case 0x84: //Zero Page STY
-			tickFunction = std::bind(&CPU::zeroPage_Store, this, reg.Y);
-			break;
-		case 0x94: //Zero Page,X STY
-			tickFunction = std::bind(&CPU::zeroPageIndexed_Store, this, reg.Y, reg.X);
-			break;
-		case 0x8C: //Absolute STY
-			tickFunction = std::bind(&CPU::absolute_Store, this, reg.Y);
-			break;
-		case 0xAA: //Implied TAX
-			executeInstruction = std::bind(&CPU::TAX, this);
-			tickFunction = std::bind(&CPU::implied, this, executeInstruction);
-			break;
-		case 0xA8: //Implied TAY
-			executeInstruction = std::bind(&CPU::TAY, this);
-			tickFunction = std::bind(&CPU::implied, this, executeInstruction);
-			break;
-		case 0xBA: //Implied TSX
-			executeInstruction = std::bind(&CPU::TSX, this);
-			tickFunction = std::bind(&CPU::implied, this, executeInstruction);
-			break;
-		case 0x8A: //Implied TXA
-			executeInstruction = std::bind(&CPU::TXA, this);
-			tickFunction = std::bind(&CPU::implied, this, executeInstruction);
-			break;
-		case 0x9A: //Implied TXS
-			executeInstruction = std::bind(&CPU::TXS, this);
-			tickFunction = std::bind(&CPU::implied, this, executeInstruction);
-			break;
-		case 0x98: //Implied TYA
-			executeInstruction = std::bind(&CPU::TYA, this);
-			tickFunction = std::bind(&CPU::implied, this, executeInstruction);
-			break;
-		default:
-			throw UnkownOPCode(currentOP, cycleCount, totalCycles, reg.PC);
-	}
-	tickFunction();
+	tickFunction = opTable[currentOP];
+	(this->*tickFunction)();
 }
\ No newline at end of file
@@ -11,10 +11,7 @@ uint8_t Controllers::read(uint16_t address)
     if(address == 0x4016) //For now, only read from controller one. TODO: use address to determine which controller to read from
     {
         if(S)
-        {
-            const uint8_t* currentKeyStates = SDL_GetKeyboardState(NULL);
-            controllerBit = (currentKeyStates[SDL_SCANCODE_L] ? 0x01 : 0x00); //Check A key
-        }
+            controllerBit = (buttons[0] & 0x01); //A button
         else
         {
             controllerBit |= (JOY1 & 0x01);
@@ -35,53 +32,22 @@ void Controllers::write(uint8_t data)
     else
     {
         S = false;
-        getKeyPresses();
+        JOY1 = buttons[0];
     }
 }
 
-void Controllers::getKeyPresses()
+void Controllers::setButtons(int controller, uint8_t state)
 {
-    const uint8_t* currentKeyStates = SDL_GetKeyboardState(NULL);
-
-    if(currentKeyStates[SDL_SCANCODE_L]) //A
-        JOY1 |= 0b00000001;
-    else
-        JOY1 &= 0b11111110;
-
-    if(currentKeyStates[SDL_SCANCODE_K]) //B
-        JOY1 |= 0b00000010;
-    else
-        JOY1 &= 0b11111101;  
-
-    if(currentKeyStates[SDL_SCANCODE_O]) //Select
-        JOY1 |= 0b00000100;
-    else
-        JOY1 &= 0b11111011;  
-
-    if(currentKeyStates[SDL_SCANCODE_P]) //START
-        JOY1 |= 0b00001000;
-    else
-        JOY1 &= 0b11110111;
-
-    if(currentKeyStates[SDL_SCANCODE_W]) //UP
-        JOY1 |= 0b00010000;
-    else
-        JOY1 &= 0b11101111; 
-
-    if(currentKeyStates[SDL_SCANCODE_S]) //DOWN
-        JOY1 |= 0b00100000;
-    else
-        JOY1 &= 0b11011111;  
-
-    if(currentKeyStates[SDL_SCANCODE_A]) //LEFT
-        JOY1 |= 0b01000000;
-    else
-        JOY1 &= 0b10111111;   
+    //Bit order matches the serial read order: A, B, Select, Start, Up, Down, Left, Right
+    buttons[controller & 0x01] = state;
+}
 
-    if(currentKeyStates[SDL_SCANCODE_D]) //RIGHT
-        JOY1 |= 0b10000000;
-    else
-        JOY1 &= 0b01111111;  
+void Controllers::serialize(SaveState& state)
+{
+    state.field(S);
+    state.field(JOY1);
+    state.field(JOY2);
+    state.field(buttons);
 }
 
 Controllers::~Controllers()
@@ -1,11 +1,17 @@
 #include "include/GameWindow.hpp"
+#include <algorithm>
+#include <iostream>
 
-GameWindow::GameWindow()
+GameWindow::GameWindow(int runAheadFrames)
+: runAheadFrames(runAheadFrames), frames(frameSize), input(0), quit(false), audio(audioCapacity)
 {
-    frameBuffer = new char[SCREEN_WIDTH * SCREEN_HEIGHT * channels];
-    screenSurface = SDL_CreateRGBSurfaceFrom((void*)frameBuffer, SCREEN_WIDTH, SCREEN_HEIGHT, channels * 8, SCREEN_WIDTH * channels, 0x0000FF, 0x00FF00, 0xFF0000, 0);
-    SDL_Init(SDL_INIT_VIDEO);
-    window = SDL_CreateWindow("NES", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
+    SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO);
+    window = SDL_CreateWindow("NES", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH * SCREEN_SCALE, SCREEN_HEIGHT * SCREEN_SCALE,
+                              SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_PRESENTVSYNC);
+    SDL_RenderSetLogicalSize(renderer, SCREEN_WIDTH, SCREEN_HEIGHT);
+    SDL_RenderSetIntegerScale(renderer, SDL_TRUE);
+    createTexture();
 
     int choice = 0;
 
@@ -14,57 +20,256 @@ GameWindow::GameWindow()
     switch(choice)
     {
         case 0:
-            nes = new NES("C:/Users/Chris/Desktop/NES/roms/nestest.nes", frameBuffer);
+            nes = new NES("C:/Users/Chris/Desktop/NES/roms/nestest.nes");
             break;
         case 1:
-            nes = new NES("C:/Users/Chris/Desktop/NES/roms/DonkeyKong.nes", frameBuffer);
+            nes = new NES("C:/Users/Chris/Desktop/NES/roms/DonkeyKong.nes");
             break;
         case 2:
-            nes = new NES("C:/Users/Chris/Desktop/NES/roms/Mario.nes", frameBuffer);
+            nes = new NES("C:/Users/Chris/Desktop/NES/roms/Mario.nes");
             break;
     }
 
-    //nes = new NES("C:/Users/Chris/Desktop/NES/roms/Mario.nes", frameBuffer);
+    //nes = new NES("C:/Users/Chris/Desktop/NES/roms/Mario.nes");
+    nes->setRunAhead(runAheadFrames);
+    openAudio();
+}
+
+void GameWindow::openAudio()
+{
+    SDL_AudioSpec want = {}, have = {};
+    want.freq = audioSampleRate;
+    want.format = AUDIO_S16SYS;
+    want.channels = 1;
+    want.samples = 512;
+    want.callback = &GameWindow::audioCallback;
+    want.userdata = this;
+
+    audioDevice = SDL_OpenAudioDevice(NULL, 0, &want, &have, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+    if(audioDevice == 0)
+    {
+        std::cerr << "No audio device, pacing with the clock instead: " << SDL_GetError() << std::endl;
+        return;
+    }
+
+    sampleRate = have.freq;
+    audioTarget = have.samples + 2 * have.freq / SCREEN_FPS;
+    nes->setSampleRate(have.freq);
+    SDL_PauseAudioDevice(audioDevice, 0);
+}
+
+void GameWindow::audioCallback(void* userdata, Uint8* stream, int length)
+{
+    GameWindow* window = static_cast<GameWindow*>(userdata);
+    int16_t* samples = reinterpret_cast<int16_t*>(stream);
+    size_t count = length / sizeof(int16_t);
+
+    //Running dry holds the last level, dropping to zero would click
+    size_t available = window->audio.read(samples, count);
+    if(available > 0)
+        window->lastSample = samples[available - 1];
+    std::fill(samples + available, samples + count, window->lastSample);
+}
+
+void GameWindow::createTexture()
+{
+    //Take the first format the renderer lists that the palette can write, the texture then never needs converting again.
+    //SDL's RGBA32/BGRA32 names are byte orders, the same as PixelFormat's
+    SDL_RendererInfo info;
+    Uint32 sdlFormat = SDL_PIXELFORMAT_BGRA32;
+    textureFormat = BGRA32;
+
+    if(SDL_GetRendererInfo(renderer, &info) == 0)
+    {
+        for(Uint32 i = 0; i < info.num_texture_formats; ++i)
+        {
+            Uint32 candidate = info.texture_formats[i];
+            if(candidate == SDL_PIXELFORMAT_BGRA32)
+                textureFormat = BGRA32;
+            else if(candidate == SDL_PIXELFORMAT_RGBA32)
+                textureFormat = RGBA32;
+            else if(candidate == SDL_PIXELFORMAT_RGB565)
+                textureFormat = RGB565;
+            else if(candidate == SDL_PIXELFORMAT_RGB24)
+                textureFormat = RGB24;
+            else
+                continue;
+
+            sdlFormat = candidate;
+            break;
+        }
+    }
+
+    texture = SDL_CreateTexture(renderer, sdlFormat, SDL_TEXTUREACCESS_STREAMING, SCREEN_WIDTH, SCREEN_HEIGHT);
 }
 
 void GameWindow::run()
 {
-    bool quit = false;
+    emulation = std::thread(&GameWindow::emulate, this);
 
     SDL_Event e;
 
-    uint32_t startTime;
-    int frameTicks;
-
     while(!quit)
     {
-        startTime = SDL_GetTicks();
-
         while(SDL_PollEvent(&e) != 0)
         {
             if(e.type == SDL_QUIT)
                 quit = true;
         }
 
-        nes->prepareFrame();
+        input.store(pollKeyboard(), std::memory_order_relaxed);
+
+        //Presenting can take as long as it likes, the emulation thread keeps its own pace and only the newest frame is shown
+        if(!update())
+            SDL_Delay(1);
+    }
+
+    emulation.join();
+}
+
+void GameWindow::emulate()
+{
+    const std::chrono::steady_clock::duration framePeriod = std::chrono::nanoseconds(1000000000 / SCREEN_FPS);
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now();
+
+    while(!quit)
+    {
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+        uint16_t buttons = input.load(std::memory_order_relaxed);
+
+        //Holding backspace plays history backwards, each step restores an older frame and redraws it
+        if(buttons & rewindHeld)
+        {
+            if(rewind.pop(rewindState))
+                nes->loadState(rewindState);
+            nes->prepareFrame();
+        }
+        else
+        {
+            nes->setButtons(0, buttons & 0xFF);
+            nes->prepareFrame();
+            nes->saveState(rewindState);
+            rewind.push(rewindState);
+        }
+
+        uint8_t* frame = frames.back();
+        nes->copyFrame(frame, frame + SCREEN_WIDTH * SCREEN_HEIGHT);
+        frames.publish();
+        queueAudio();
+        reportLag(std::chrono::steady_clock::now() - startTime);
 
-        frameTicks = SDL_GetTicks() - startTime;
+        if(audioDevice)
+        {
+            waitForAudio();
+            continue;
+        }
 
-        if(frameTicks < SCREEN_TICKS_PER_FRAME)
-            SDL_Delay(SCREEN_TICKS_PER_FRAME - frameTicks);
+        //A thread that fell more than a frame behind starts pacing again from now rather than racing to catch up
+        deadline += framePeriod;
+        if(deadline < std::chrono::steady_clock::now() - framePeriod)
+            deadline = std::chrono::steady_clock::now();
+        std::this_thread::sleep_until(deadline);
+    }
+}
 
-        update();
+void GameWindow::queueAudio()
+{
+    int16_t samples[2048];
+    size_t count;
+    while((count = nes->readSamples(audioDevice ? samples : nullptr, sizeof(samples) / sizeof(samples[0]))) > 0)
+    {
+        if(audioDevice)
+            audio.write(samples, count);
     }
 }
 
+void GameWindow::waitForAudio()
+{
+    //The device plays at its own steady rate, so sleeping until it has used up everything above the target paces
+    //emulation to the sound card instead of a timer
+    size_t queued = audio.size();
+    if(queued > audioTarget)
+        std::this_thread::sleep_for(std::chrono::microseconds((queued - audioTarget) * 1000000 / sampleRate));
+
+    //What's left over is timing jitter, a slightly faster or slower sample rate for the next frame pulls the ring back
+    //towards the target without the pitch change being audible
+    double error = ((double)audioTarget - (double)audio.size()) / audioTarget;
+    nes->adjustSampleRate(1.0 + std::max(-maxRateAdjust, std::min(maxRateAdjust, error * maxRateAdjust)));
+}
+
+void GameWindow::reportLag(std::chrono::steady_clock::duration frameTime)
+{
+    //Run ahead multiplies the emulation work per frame, once a second say how many frames missed their slot
+    if(frameTime > std::chrono::nanoseconds(1000000000 / SCREEN_FPS))
+        ++lateFrames;
+
+    if(++measuredFrames < SCREEN_FPS)
+        return;
+
+    if(lateFrames > 0)
+        std::cerr << "Can't keep up: " << lateFrames << " of the last " << measuredFrames << " frames took longer than "
+                  << 1000.0 / SCREEN_FPS << "ms (run ahead " << runAheadFrames << ")" << std::endl;
+
+    lateFrames = 0;
+    measuredFrames = 0;
+}
+
+uint16_t GameWindow::pollKeyboard()
+{
+    const uint8_t* currentKeyStates = SDL_GetKeyboardState(NULL);
+    uint16_t buttons = 0x00;
+
+    if(currentKeyStates[SDL_SCANCODE_L]) //A
+        buttons |= 0b00000001;
+    if(currentKeyStates[SDL_SCANCODE_K]) //B
+        buttons |= 0b00000010;
+    if(currentKeyStates[SDL_SCANCODE_O]) //Select
+        buttons |= 0b00000100;
+    if(currentKeyStates[SDL_SCANCODE_P]) //START
+        buttons |= 0b00001000;
+    if(currentKeyStates[SDL_SCANCODE_W]) //UP
+        buttons |= 0b00010000;
+    if(currentKeyStates[SDL_SCANCODE_S]) //DOWN
+        buttons |= 0b00100000;
+    if(currentKeyStates[SDL_SCANCODE_A]) //LEFT
+        buttons |= 0b01000000;
+    if(currentKeyStates[SDL_SCANCODE_D]) //RIGHT
+        buttons |= 0b10000000;
+    if(currentKeyStates[SDL_SCANCODE_BACKSPACE])
+        buttons |= rewindHeld;
+
+    return buttons;
+}
+
 GameWindow::~GameWindow()
 {
+    quit = true;
+    if(emulation.joinable())
+        emulation.join();
+    if(audioDevice)
+        SDL_CloseAudioDevice(audioDevice);
+    SDL_DestroyTexture(texture);
+    SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
 }
 
-void GameWindow::update()
+bool GameWindow::update()
 {
-    SDL_BlitSurface(screenSurface, 0, SDL_GetWindowSurface(window), 0);
-    SDL_UpdateWindowSurface(window);
+    if(!frames.acquire())
+        return false;
+
+    void* pixels;
+    int pitch;
+    if(SDL_LockTexture(texture, NULL, &pixels, &pitch) == 0)
+    {
+        const uint8_t* frame = frames.front();
+        palette.convert(frame, frame + SCREEN_WIDTH * SCREEN_HEIGHT, textureFormat, pixels, pitch);
+        SDL_UnlockTexture(texture);
+    }
+
+    SDL_RenderClear(renderer);
+    SDL_RenderCopy(renderer, texture, NULL, NULL);
+    SDL_RenderPresent(renderer);
+    return true;
 }
\ No newline at end of file
@@ -1,166 +1,199 @@
 #include "include/NES.hpp"
 #include "mappers/NROM.hpp"
 #include "mappers/MMC1.hpp"
-#include <cassert>
+#include <cstring>
 #include <iomanip>
+#include <string>
 
-NES::NES(const char* file, char* frameBuffer)
+NES::NES(const char* file) : NES(std::make_shared<const RomImage>(file))
 {
-	loadROM(file);
-	createPalette();
+
+}
+
+NES::NES(std::shared_ptr<const RomImage> rom)
+{
+	loadROM(rom);
+	scheduler = new Scheduler();
 	controllers = new Controllers();
-	apu = new APU();
-	ppu = new PPU(cart, colors, frameBuffer, frameReady);
-	cpu = new CPU(cart, *ppu, *apu, *controllers);
+	apu = new APU(*cart, *scheduler);
+	ppu = new PPU(cart, *scheduler, frameBuffer, emphasis, frameReady);
+	cpu = new CPU(cart, *ppu, *apu, *controllers, *scheduler);
 }
 
 void NES::prepareFrame()
 {
-	while(!frameReady)
+	if(runAheadFrames == 0)
 	{
-		cpu->tick();
-		ppu->tick();
-		ppu->tick();
-		ppu->tick();
+		runFrame();
+		return;
 	}
-	frameReady = false;
+
+	//The real frame is emulated without output and saved, then the frames after it are run with the same input and
+	//the last one is shown. Going back to the saved state throws the extra frames away, only the real frame is heard
+	ppu->setOutputEnabled(false);
+	runFrame();
+	saveState(runAheadState);
+	apu->setOutputEnabled(false);
+	for(int i = 1; i < runAheadFrames; ++i)
+		runFrame();
+	ppu->setOutputEnabled(true);
+	runFrame();
+	loadState(runAheadState);
+	apu->setOutputEnabled(true);
 }
 
-NES::~NES()
+void NES::setRunAhead(int frames)
 {
-	delete cpu;
-	delete ppu;
-	delete apu;
-	delete controllers;
-	delete cart;
-	delete[] colors;
+	runAheadFrames = frames;
 }
 
-void NES::loadROM(const char* file)
+void NES::runFrame()
 {
-	std::ifstream rom(file, std::ios::binary);
-	decodeHeader(rom);
-	int mapperNumber = (header.Flags7 & 0xF0) + (header.Flags6 >> 4);
-	switch(mapperNumber)
+	if(executionMode == instructionStepped)
 	{
-		case 0:
-			cart = new NROM(header, rom);
-			break;
-		case 1:
-			cart = new MMC1(header, rom);
-			break;
-		default:
-			throw;
+		//Instructions run back to back, the PPU only catches up on register access or when the CPU reaches a scheduled event.
+		//Vblank is always scheduled and comes after the last visible pixel, so it also ends the frame
+		while(!frameReady)
+			cpu->step();
+	}
+	else
+	{
+		while(!frameReady)
+		{
+			cpu->tick();
+			ppu->tick();
+			ppu->tick();
+			ppu->tick();
+		}
 	}
-	rom.close();
+	frameReady = false;
+	apu->endFrame(cpu->elapsedCycles());
+}
+
+void NES::renderFrame(PixelFormat format, void* pixels, int pitch) const
+{
+	palette.convert(frameBuffer, emphasis, format, pixels, pitch);
+}
+
+void NES::copyFrame(uint8_t* indices, uint8_t* emphasis) const
+{
+	std::memcpy(indices, frameBuffer, sizeof(frameBuffer));
+	std::memcpy(emphasis, this->emphasis, sizeof(this->emphasis));
 }
 
-void NES::decodeHeader(std::ifstream& rom)
+size_t NES::readSamples(int16_t* out, size_t count)
 {
-	uint8_t temp;
-	uint32_t headerCheck = 0;
+	return apu->readSamples(out, count);
+}
 
-	for(int i = 0; i < 4; ++i)
+size_t NES::samplesAvailable() const
+{
+	return apu->samplesAvailable();
+}
+
+void NES::setSampleRate(int rate)
+{
+	apu->setSampleRate(rate);
+}
+
+void NES::adjustSampleRate(double ratio)
+{
+	apu->adjustSampleRate(ratio);
+}
+
+void NES::setExecutionMode(ExecutionMode mode)
+{
+	cpu->syncPPU();
+	cpu->setExecutionMode(mode);
+	executionMode = mode;
+}
+
+void NES::setButtons(int controller, uint8_t buttons)
+{
+	controllers->setButtons(controller, buttons);
+}
+
+uint64_t NES::elapsedCycles() const
+{
+	return cpu->elapsedCycles();
+}
+
+void NES::setTrace(Trace* trace)
+{
+	cpu->setTrace(trace);
+}
+
+void NES::setProgramCounter(uint16_t address)
+{
+	cpu->setProgramCounter(address);
+}
+
+void NES::saveState(SaveState& state)
+{
+	//Instruction stepped mode leaves the PPU behind the CPU, the snapshot has to see both at the same point
+	cpu->syncPPU();
+	apu->runUntil(cpu->elapsedCycles());
+
+	if(stateSize == 0)
 	{
-		rom >> std::hex >> temp;
-		headerCheck = (headerCheck << 8) + temp;
+		state.beginMeasure();
+		serialize(state);
+		stateSize = state.payloadSize();
 	}
 
-	assert(headerCheck == 0x4E45531A);
+	state.beginSave(stateSize);
+	serialize(state);
+	state.finish();
+}
 
-	rom >> std::hex >> header.PRG_ROM_SIZE;
-	rom >> std::hex >> header.CHR_ROM_SIZE;
-	rom >> std::hex >> header.Flags6;
-	rom >> std::hex >> header.Flags7;
-	rom >> std::hex >> header.Flags8;
-	rom >> std::hex >> header.Flags9;
-	rom >> std::hex >> header.Flags10;
+void NES::loadState(SaveState& state)
+{
+	if(stateSize == 0)
+	{
+		SaveState measure;
+		measure.beginMeasure();
+		serialize(measure);
+		stateSize = measure.payloadSize();
+	}
 
-	for(int i = 0; i < 5; ++i)
-		rom >> std::hex >> temp;
+	state.beginLoad(stateSize);
+	serialize(state);
+	state.finish();
 }
 
-void NES::createPalette()
+void NES::serialize(SaveState& state)
 {
-	uint8_t paletteArray[192] = 
-	{
-		0x7C, 0x7C, 0x7C,
-		0x00, 0x00, 0xFC,
-		0x00, 0x00, 0xBC,
-		0x44, 0x28, 0xBC,
-		0x94, 0x00, 0x84,
-		0xA8, 0x00, 0x20,
-		0xA8, 0x10, 0x00,
-		0x88, 0x14, 0x00,
-		0x50, 0x30, 0x00,
-		0x00, 0x78, 0x00,
-		0x00, 0x68, 0x00,
-		0x00, 0x58, 0x00,
-		0x00, 0x40, 0x58,
-		0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00,
-		0xBC, 0xBC, 0xBC,
-		0x00, 0x78, 0xF8,
-		0x00, 0x58, 0xF8,
-		0x68, 0x44, 0xFC,
-		0xD8, 0x00, 0xCC,
-		0xE4, 0x00, 0x58,
-		0xF8, 0x38, 0x00,
-		0xE4, 0x5C, 0x10,
-		0xAC, 0x7C, 0x00,
-		0x00, 0xB8, 0x00,
-		0x00, 0xA8, 0x00,
-		0x00, 0xA8, 0x44,
-		0x00, 0x88, 0x88,
-		0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00,
-		0xF8, 0xF8, 0xF8,
-		0x3C, 0xBC, 0xFC,
-		0x68, 0x88, 0xFC,
-		0x98, 0x78, 0xF8,
-		0xF8, 0x78, 0xF8,
-		0xF8, 0x58, 0x98,
-		0xF8, 0x78, 0x58,
-		0xFC, 0xA0, 0x44,
-		0xF8, 0xB8, 0x00,
-		0xB8, 0xF8, 0x18,
-		0x58, 0xD8, 0x54,
-		0x58, 0xF8, 0x98,
-		0x00, 0xE8, 0xD8,
-		0x78, 0x78, 0x78,
-		0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00,
-		0xFC, 0xFC, 0xFC,
-		0xA4, 0xE4, 0xFC,
-		0xB8, 0xB8, 0xF8,
-		0xD8, 0xB8, 0xF8,
-		0xF8, 0xB8, 0xF8,
-		0xF8, 0xA4, 0xC0,
-		0xF0, 0xD0, 0xB0,
-		0xFC, 0xE0, 0xA8,
-		0xF8, 0xD8, 0x78,
-		0xD8, 0xF8, 0x78,
-		0xB8, 0xF8, 0xB8,
-		0xB8, 0xF8, 0xD8,
-		0x00, 0xFC, 0xFC,
-		0xF8, 0xD8, 0xF8,
-		0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00
-	};
-
-	colors = new RGB[64];
-	std::ifstream paletteFile("../palette/palette.pal", std::ios::binary);
-	int j = 0;
-	for(int i = 0; i < 64; ++i)
+	cpu->serialize(state);
+	ppu->serialize(state);
+	apu->serialize(state);
+	controllers->serialize(state);
+	scheduler->serialize(state);
+	cart->serialize(state);
+	state.field(frameReady);
+}
+
+NES::~NES()
+{
+	delete cpu;
+	delete ppu;
+	delete apu;
+	delete controllers;
+	delete scheduler;
+	delete cart;
+}
+
+void NES::loadROM(std::shared_ptr<const RomImage> rom)
+{
+	header = rom->header();
+	switch(rom->mapperNumber())
 	{
-		// paletteFile >> std::hex >> colors[i].R;
-		// paletteFile >> std::hex >> colors[i].G;
-		// paletteFile >> std::hex >> colors[i].B;
-		colors[i].R = paletteArray[j++];
-		colors[i].G = paletteArray[j++];
-		colors[i].B = paletteArray[j++];
+		case 0:
+			cart = new NROM(rom);
+			break;
+		case 1:
+			cart = new MMC1(rom);
+			break;
+		default:
+			throw ROMFileError("Unsupported mapper", std::to_string(rom->mapperNumber()));
 	}
-	paletteFile.close();
 }
\ No newline at end of file
@@ -1,12 +1,17 @@
 #include "include/PPU.hpp"
 
-PPU::PPU(Cartridge* cartridge, RGB* color, char* fb, bool& frameReady)
-: cart(*cartridge), colors(color), frameBuffer(fb), frameReady(frameReady)
+PPU::PPU(Cartridge* cartridge, Scheduler& scheduler, uint8_t* fb, uint8_t* emphasis, bool& frameReady)
+: cart(*cartridge), tileCache(*cartridge), scheduler(scheduler), frameBuffer(fb), emphasis(emphasis), frameReady(frameReady)
 {
     for(int i = 0; i < 0x800; ++i)
         VRAM[i] = 0x00;
     for(int i = 0; i < 0x20; ++i)
         paletteRAM[i] = 0x00;
+    for(int i = 0; i < 8; ++i)
+        OAM_Secondary[i].clear();
+
+    scheduler.setHandler(vblankStart, [this](uint64_t now){ catchUp(now); scheduleVBlank(); });
+    scheduleVBlank();
 }
 
 PPU::~PPU()
@@ -14,6 +19,47 @@ PPU::~PPU()
     
 }
 
+void PPU::serialize(SaveState& state)
+{
+    state.field(reg);
+    state.block(VRAM, sizeof(VRAM));
+    state.block(OAM, sizeof(OAM));
+    state.block(OAM_Secondary, sizeof(OAM_Secondary));
+    state.block(paletteRAM, sizeof(paletteRAM));
+    state.field(vblank);
+    state.field(nmi);
+    state.field(scanline);
+    state.field(dot);
+    state.field(oddFrame);
+    state.field(clock);
+
+    state.field(OAM_Location);
+    state.field(spriteFetchCycle);
+
+    state.field(BG_Pixel);
+    state.field(backgroundFetchCycle);
+    state.field(NT_Byte);
+    state.field(AT_Byte);
+    state.field(PT_High);
+    state.field(PT_Low);
+    state.field(PT_Address);
+    state.field(PT_Shifter_High);
+    state.field(PT_Shifter_Low);
+    state.field(AT_Shifter_High);
+    state.field(AT_Shifter_Low);
+    state.field(AT_Latch_High);
+    state.field(AT_Latch_Low);
+    state.field(frameBufferPointer);
+
+    //Loading may have changed CHR RAM or banks behind the cache's back
+    if(state.isLoading())
+    {
+        tileCache.clear();
+        spriteLinesDirty = true;
+        composeSpriteLine();
+    }
+}
+
 uint8_t PPU::readMemMappedReg(uint16_t address)
 {
     if(address > 0x2007)
@@ -69,6 +115,7 @@ void PPU::writeMemMappedReg(uint16_t address, uint8_t data)
             break;
         case 0x2004: //OAMDATA
             OAM[reg.OAMADDR++] = data;
+            spriteLinesDirty = true;
             break;
         case 0x2005: //PPUSCROLL
             if(!reg.w) //First write
@@ -120,7 +167,10 @@ void PPU::write(uint16_t address, uint8_t data)
 {
     address %= 0x4000;
     if(address < 0x2000) //Pattern tables
+    {
         cart.writeCHR(address, data);
+        tileCache.invalidate(address);
+    }
     else if(address < 0x3F00)
         VRAM[nametableAddress(address)] = data;
     else
@@ -151,6 +201,42 @@ void PPU::tick()
     }
 
     incDot();
+    ++clock;
+}
+
+void PPU::catchUp(uint64_t targetClock)
+{
+    while(clock < targetClock)
+    {
+        //Any register access syncs the PPU first, so a line that fits entirely before the target can't be touched part way through
+        //and is run in one go. Lines the CPU cut into finish on the dot renderer
+        if(dot == 0 && targetClock - clock >= 341 && scanline != -1 && scanline != 241)
+        {
+            if(scanline < 240 && renderingEnabled())
+            {
+                if(backgroundFetchCycle != 0)
+                    tick();
+                else
+                    renderScanline();
+            }
+            else
+                skipScanline();
+        }
+        else
+            tick();
+    }
+}
+
+void PPU::scheduleVBlank()
+{
+    //Dots until the vblank flag is set at scanline 241 dot 1. Odd frames are assumed to skip a dot so the event is never late,
+    //firing early is harmless since the handler reschedules from wherever the PPU ends up
+    int dots = ((241 + 1) * 341 + 1) - ((scanline + 1) * 341 + dot);
+    if(dots < 0)
+        dots += 262 * 341;
+    if(scanline == -1 || dots > 241 * 341)
+        --dots;
+    scheduler.schedule(vblankStart, clock + dots + 1);
 }
 
 void PPU::prerenderScanline()
@@ -191,7 +277,6 @@ void PPU::visibleScanline()
     if(dot < 257)
     {
         getBackgroundPixel();
-        getSpritePixel();
         renderPixel();
         backgroundFetch();
     }
@@ -209,6 +294,65 @@ void PPU::visibleScanline()
         backgroundFetch();
 }
 
+void PPU::renderScanline()
+{
+    //Same work as 341 calls to visibleScanline(). The background comes out of the tile cache as a strip of palette indices: the two
+    //tiles already in the shifters followed by the 32 fetched on this line, with fine x picking where the visible line starts
+    uint8_t background[34 * 8];
+    uint8_t latchAttribute = (AT_Latch_High ? 0x08 : 0x00) | (AT_Latch_Low ? 0x04 : 0x00);
+    for(int i = 0; i < 16; ++i)
+    {
+        background[i] = (((PT_Shifter_High >> (15 - i)) & 0x01) << 1) | ((PT_Shifter_Low >> (15 - i)) & 0x01);
+        if(i < 8)
+            background[i] |= (((AT_Shifter_High >> (7 - i)) & 0x01) << 3) | (((AT_Shifter_Low >> (7 - i)) & 0x01) << 2);
+        else
+            background[i] |= latchAttribute;
+    }
+
+    for(int tile = 0; tile < 32; ++tile)
+    {
+        shiftTile();
+        uint64_t pixels = fetchTile();
+        uint8_t attribute = (AT_Latch_High ? 0x08 : 0x00) | (AT_Latch_Low ? 0x04 : 0x00);
+        for(int i = 0; i < 8; ++i)
+            background[16 + tile * 8 + i] = ((pixels >> (i * 8)) & 0x03) | attribute;
+    }
+
+    for(int x = 0; x < 256; ++x)
+    {
+        dot = x + 1;
+        BG_Pixel = 0x3F00 | background[x + reg.x];
+        renderPixel();
+    }
+    incVertV();
+
+    dot = 257;
+    setHoriV();
+    spriteEval();
+    for(OAM_Location = 0; OAM_Location < 8; ++OAM_Location)
+    {
+        spritePatternAddress();
+        fetchSpritePattern();
+    }
+    spriteFetchCycle = 0;
+
+    //Dots 321-336, first two tiles of the next line
+    shiftTile();
+    fetchTile();
+    shiftTile();
+    fetchTile();
+
+    clock += 341;
+    nextScanline();
+}
+
+void PPU::skipScanline()
+{
+    //Nothing happens on this line, only the vblank line and pre-render line have work outside of rendering
+    clock += 341;
+    nextScanline();
+}
+
 bool PPU::renderingEnabled()
 {
     return (reg.PPUMASK & 0x18);
@@ -223,6 +367,11 @@ void PPU::disabledRenderingDisplay()
 void PPU::setNMI()
 {
     nmi = (reg.PPUCTRL & 0x80) && (reg.PPUSTATUS & 0x80);
+
+    if(nmi) //The CPU sees it once the current dot has finished
+        scheduler.schedule(nmiRaised, clock + 1);
+    else
+        scheduler.cancel(nmiRaised);
 }
 
 uint16_t PPU::nametableAddress(uint16_t address)
@@ -232,7 +381,7 @@ uint16_t PPU::nametableAddress(uint16_t address)
     if(address > 0x2FFF)
         address -= 0x1000;
 
-    if(cart.verticalMirroring())
+    if(cart.nametableMirroring() == vertical)
 		address = (address - 0x2000) - (address / 0x2800 * 0x800);
     else
         address = (address - 0x2000) - (address / 0x2400 * 0x400) - (address / 0x2C00 * 0x400);
@@ -312,43 +461,48 @@ void PPU::incDot()
     if(dot < 339)
         ++dot;
     else if(dot == 339 && scanline == -1 && oddFrame && renderingEnabled())
-    {
-        dot = 0;
-        ++scanline;
-    }
+        nextScanline();
     else if(dot == 339)
         ++dot;
     else
+        nextScanline();
+}
+
+void PPU::nextScanline()
+{
+    dot = 0;
+    ++scanline;
+    if(scanline == 261)
     {
-        dot = 0;
-        ++scanline;
-        if(scanline == 261)
-        {
-            scanline = -1;
-            oddFrame = !oddFrame;
-        }
-    }    
+        scanline = -1;
+        oddFrame = !oddFrame;
+    }
+    else if(scanline < 240)
+        composeSpriteLine();
 }
 
-void PPU::getSpritePixel()
+void PPU::composeSpriteLine()
 {
+    for(int x = 0; x < 256; ++x)
+        spriteLine[x] = 0;
+
+    //Nothing was evaluated for the first line
     if(scanline == 0)
         return;
 
-    spritePixel = 0x3F10;
-    BG_Priority = true;
-  
+    //Lower slots are drawn last so they end up in front
     for(int i = 7; i >= 0; --i)
     {
-        if(OAM_Secondary[i].decrementX())
+        const Sprite& sprite = OAM_Secondary[i];
+        if(!sprite.pattern)
+            continue;
+
+        uint8_t flags = ((sprite.attributes & 0x03) << 2) | ((sprite.attributes & 0x20) ? spriteBehind : 0) | (sprite.sprite0 ? spriteZero : 0);
+        for(int j = 0; j < 8 && sprite.X + j < 256; ++j)
         {
-            uint8_t lowSpriteNibble = OAM_Secondary[i].getPixelNibble();
-            if(lowSpriteNibble & 0x03)
-            {
-                checkSprite0Hit = OAM_Secondary[i].sprite0;
-                spritePixel = 0x3F10 | lowSpriteNibble;
-                BG_Priority = OAM_Secondary[i].attributes & 0x20;
-            }
+            uint8_t pixel = (sprite.pattern >> (j * 8)) & 0x03;
+            if(pixel)
+                spriteLine[sprite.X + j] = flags | pixel;
         }
     }
 }
@@ -358,55 +512,60 @@ void PPU::spriteEval()
     for(int i = 0; i < 8; ++i)
         OAM_Secondary[i].clear();
 
-    int N = 0;
-    int spriteCount = 0;
-    OAM_Location = 0;
-    int offset;
+    bool tall = reg.PPUCTRL & 0x20;
+    if(spriteLinesDirty || tall != spriteLinesTall)
+        buildSpriteLines();
 
-    while(N < 256)
+    for(OAM_Location = 0; OAM_Location < lineSpriteCount[scanline]; ++OAM_Location)
     {
-        if(spriteCount == 8)
-        {
-            spriteOverflowEval(N);
-            break;
-        }
-        else
-        {
-            OAM_Secondary[OAM_Location].Y = OAM[N];
-            offset = scanline - OAM[N];
-            if(offset >= 0 && offset < ((reg.PPUCTRL & 0x20) ? 16 : 8))
-            {
-                if(N == 0)
-                    OAM_Secondary[OAM_Location].sprite0 = true;
+        int entry = lineSprites[scanline][OAM_Location] * 4;
+        OAM_Secondary[OAM_Location].Y = OAM[entry];
+        OAM_Secondary[OAM_Location].tile = OAM[entry + 1];
+        OAM_Secondary[OAM_Location].attributes = OAM[entry + 2];
+        OAM_Secondary[OAM_Location].X = OAM[entry + 3];
+        OAM_Secondary[OAM_Location].offset = scanline - OAM[entry];
+        OAM_Secondary[OAM_Location].sprite0 = (entry == 0);
+    }
 
-                OAM_Secondary[OAM_Location].offset = offset;
+    if(lineSpriteOverflow[scanline])
+        reg.PPUSTATUS |= 0x20;
+}
 
-                OAM_Secondary[OAM_Location].tile = OAM[N + 1];
-                OAM_Secondary[OAM_Location].attributes = OAM[N + 2];
-                OAM_Secondary[OAM_Location].X = OAM[N + 3];
+void PPU::buildSpriteLines()
+{
+    spriteLinesTall = reg.PPUCTRL & 0x20;
+    spriteLinesDirty = false;
+    int height = spriteLinesTall ? 16 : 8;
 
-                ++spriteCount;
-                ++OAM_Location;
-            }
-        }     
+    for(int line = 0; line < 240; ++line)
+        lineSpriteCount[line] = 0;
 
-        N +=4;
+    //Each sprite lands in the lines it covers, the first eight per line win just like the in-order OAM scan
+    for(int i = 0; i < 64; ++i)
+    {
+        int Y = OAM[i * 4];
+        for(int line = Y; line < Y + height && line < 240; ++line)
+        {
+            if(lineSpriteCount[line] < 8)
+                lineSprites[line][lineSpriteCount[line]++] = i;
+        }
     }
+
+    //The overflow search carries on from the sprite after the eighth, with the hardware's diagonal scan
+    for(int line = 0; line < 240; ++line)
+        lineSpriteOverflow[line] = lineSpriteCount[line] == 8 && spriteOverflowEval(line, (lineSprites[line][7] + 1) * 4);
 }
 
-void PPU::spriteOverflowEval(int N)
+bool PPU::spriteOverflowEval(int line, int N)
 {
     int M = 0;
     int offset;
 
     while(N < 256)
     {
-        offset = scanline - OAM[N + M];
-        if(offset >= 0 && offset < ((reg.PPUCTRL & 0x20) ? 16 : 8))
-        {
-            reg.PPUSTATUS |= 0x20;
-            break;
-        }
+        offset = line - OAM[N + M];
+        if(offset >= 0 && offset < (spriteLinesTall ? 16 : 8))
+            return true;
         else
         {
             N += 4;
@@ -416,44 +575,56 @@ void PPU::spriteOverflowEval(int N)
                 ++M;            
         }        
     }
+    return false;
 }
 
 void PPU::spriteFetch()
 {
+    //Rendering switched on after dot 257 leaves OAM_Location wherever the last line's fetch stopped
+    if(OAM_Location > 7)
+        return;
+
     ++spriteFetchCycle;
 
     if(spriteFetchCycle == 6)
+        spritePatternAddress();
+    else if(spriteFetchCycle == 8)
     {
-        int offset = OAM_Secondary[OAM_Location].offset;
-        
-        if((reg.PPUCTRL & 0x20)) //8x16
-        {
-            if(OAM_Secondary[OAM_Location].attributes & 0x80) //Flipped vertically
-                offset = (offset - 15) * -1;
+        fetchSpritePattern();
+        spriteFetchCycle = 0;
+        ++OAM_Location;
+    }
+}
 
-            if(offset < 8)
-                PT_Address = 0x0000 | ((OAM_Secondary[OAM_Location].tile & 0x01) << 12) | ((OAM_Secondary[OAM_Location].tile & 0xFE) << 4) | offset;
-            else
-                PT_Address = 0x0000 | ((OAM_Secondary[OAM_Location].tile & 0x01) << 12) | ((OAM_Secondary[OAM_Location].tile & 0xFE) << 4) | 0x10 | offset;
-        }
-        else //8x8
-        {
-            if(OAM_Secondary[OAM_Location].attributes & 0x80) //Flipped vertically
-                offset = (offset - 7) * -1;
-            PT_Address = 0x0000 | ((reg.PPUCTRL & 0x08) << 9) | (OAM_Secondary[OAM_Location].tile << 4) | offset;
-        }
+void PPU::spritePatternAddress()
+{
+    int offset = OAM_Secondary[OAM_Location].offset;
+    
+    if((reg.PPUCTRL & 0x20)) //8x16
+    {
+        if(OAM_Secondary[OAM_Location].attributes & 0x80) //Flipped vertically
+            offset = (offset - 15) * -1;
 
-        OAM_Secondary[OAM_Location].PT_Low = read(PT_Address);
+        if(offset < 8)
+            PT_Address = 0x0000 | ((OAM_Secondary[OAM_Location].tile & 0x01) << 12) | ((OAM_Secondary[OAM_Location].tile & 0xFE) << 4) | offset;
+        else
+            PT_Address = 0x0000 | ((OAM_Secondary[OAM_Location].tile & 0x01) << 12) | ((OAM_Secondary[OAM_Location].tile & 0xFE) << 4) | 0x10 | offset;
     }
-    else if(spriteFetchCycle == 8)
+    else //8x8
     {
-        PT_Address |= 0x08;
-        OAM_Secondary[OAM_Location].PT_High = read(PT_Address);
-        spriteFetchCycle = 0;
-        ++OAM_Location;
+        if(OAM_Secondary[OAM_Location].attributes & 0x80) //Flipped vertically
+            offset = (offset - 7) * -1;
+        PT_Address = 0x0000 | ((reg.PPUCTRL & 0x08) << 9) | (OAM_Secondary[OAM_Location].tile << 4) | offset;
     }
 }
 
+void PPU::fetchSpritePattern()
+{
+    const TileCache::Row& row = tileCache.row(PT_Address);
+    OAM_Secondary[OAM_Location].pattern = (OAM_Secondary[OAM_Location].attributes & 0x40) ? row.flipped : row.pixels; //Flipped horizontally
+    PT_Address |= 0x08;
+}
+
 void PPU::sprite0Hit()
 {
     if(reg.PPUSTATUS & 0x40)
@@ -511,6 +682,30 @@ void PPU::backgroundFetch()
     }
 }
 
+uint64_t PPU::fetchTile()
+{
+    //All four fetches of backgroundFetch() at once, v doesn't change until the end of the tile
+    NT_Byte = read(0x2000 | (reg.v & 0x0FFF));
+    AT_Byte = read(0x23C0 | (reg.v & 0x0C00) | ((reg.v >> 4) & 0x38) | ((reg.v >> 2) & 0x07));
+    PT_Address = 0x0000 | ((reg.PPUCTRL & 0x10) << 8) | (NT_Byte << 4) | ((reg.v & 0x7000) >> 12);
+    const TileCache::Row& row = tileCache.row(PT_Address);
+    PT_Low = row.low;
+    PT_Address |= 0x0008;
+    PT_High = row.high;
+    loadShiftRegisters();
+    incHoriV();
+    return row.pixels;
+}
+
+void PPU::shiftTile()
+{
+    //Eight shiftRegisters() in one go
+    PT_Shifter_High <<= 8;
+    PT_Shifter_Low <<= 8;
+    AT_Shifter_High = (AT_Latch_High ? 0xFF : 0x00);
+    AT_Shifter_Low = (AT_Latch_Low ? 0xFF : 0x00);
+}
+
 void PPU::shiftRegisters()
 {
     PT_Shifter_High <<= 1;
@@ -557,6 +752,8 @@ void PPU::setAttributeLatches()
 uint8_t PPU::pixelMultiplexer()
 {
     uint16_t indexAddress;
+    uint8_t sprite = spriteLine[dot - 1];
+    uint16_t spritePixel = 0x3F10 | (sprite & 0x0F);
 
     if(dot < 9 && ((reg.PPUMASK & 0x06) != 0x06))
     {
@@ -569,7 +766,7 @@ uint8_t PPU::pixelMultiplexer()
     } 
     else
     {    
-        if(!(BG_Priority && (BG_Pixel & 0x03)))
+        if(((sprite & 0x03) && !(sprite & spriteBehind)) || !(BG_Pixel & 0x03))
             indexAddress = spritePixel;
         else
             indexAddress = BG_Pixel;
@@ -579,23 +776,40 @@ uint8_t PPU::pixelMultiplexer()
         else if(!(reg.PPUMASK & 0x10) || scanline == 0) //Sprites disabled
             indexAddress = BG_Pixel;
 
-        if(checkSprite0Hit)
+        if(sprite & spriteZero)
             sprite0Hit();
     }
 
     return read(indexAddress);
 }
 
+void PPU::setOutputEnabled(bool enabled)
+{
+    outputEnabled = enabled;
+}
+
 void PPU::renderPixel()
 {
-    uint8_t colorIndex = pixelMultiplexer();
+    if(!outputEnabled)
+    {
+        //The multiplexer's only side effect is sprite 0 hit
+        if((spriteLine[dot - 1] & spriteZero) && !(reg.PPUSTATUS & 0x40))
+            pixelMultiplexer();
+
+        if(++frameBufferPointer >= 256 * 240)
+        {
+            frameReady = true;
+            frameBufferPointer = 0;
+        }
+        return;
+    }
+
+    if((frameBufferPointer & 0xFF) == 0)
+        emphasis[frameBufferPointer >> 8] = reg.PPUMASK >> 5;
 
-    RGB color = colors[colorIndex];
-    frameBuffer[frameBufferPointer++] = color.R;
-    frameBuffer[frameBufferPointer++] = color.G;
-    frameBuffer[frameBufferPointer++] = color.B;
+    frameBuffer[frameBufferPointer++] = pixelMultiplexer() & 0x3F;
 
-    if(frameBufferPointer >= 184320)
+    if(frameBufferPointer >= 256 * 240)
     {
         frameReady = true;
         frameBufferPointer = 0;
@@ -0,0 +1,253 @@
+#include "include/Palette.hpp"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PALETTE_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	const uint8_t defaultPalette[192] =
+	{
+		0x7C, 0x7C, 0x7C,
+		0x00, 0x00, 0xFC,
+		0x00, 0x00, 0xBC,
+		0x44, 0x28, 0xBC,
+		0x94, 0x00, 0x84,
+		0xA8, 0x00, 0x20,
+		0xA8, 0x10, 0x00,
+		0x88, 0x14, 0x00,
+		0x50, 0x30, 0x00,
+		0x00, 0x78, 0x00,
+		0x00, 0x68, 0x00,
+		0x00, 0x58, 0x00,
+		0x00, 0x40, 0x58,
+		0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00,
+		0xBC, 0xBC, 0xBC,
+		0x00, 0x78, 0xF8,
+		0x00, 0x58, 0xF8,
+		0x68, 0x44, 0xFC,
+		0xD8, 0x00, 0xCC,
+		0xE4, 0x00, 0x58,
+		0xF8, 0x38, 0x00,
+		0xE4, 0x5C, 0x10,
+		0xAC, 0x7C, 0x00,
+		0x00, 0xB8, 0x00,
+		0x00, 0xA8, 0x00,
+		0x00, 0xA8, 0x44,
+		0x00, 0x88, 0x88,
+		0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00,
+		0xF8, 0xF8, 0xF8,
+		0x3C, 0xBC, 0xFC,
+		0x68, 0x88, 0xFC,
+		0x98, 0x78, 0xF8,
+		0xF8, 0x78, 0xF8,
+		0xF8, 0x58, 0x98,
+		0xF8, 0x78, 0x58,
+		0xFC, 0xA0, 0x44,
+		0xF8, 0xB8, 0x00,
+		0xB8, 0xF8, 0x18,
+		0x58, 0xD8, 0x54,
+		0x58, 0xF8, 0x98,
+		0x00, 0xE8, 0xD8,
+		0x78, 0x78, 0x78,
+		0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00,
+		0xFC, 0xFC, 0xFC,
+		0xA4, 0xE4, 0xFC,
+		0xB8, 0xB8, 0xF8,
+		0xD8, 0xB8, 0xF8,
+		0xF8, 0xB8, 0xF8,
+		0xF8, 0xA4, 0xC0,
+		0xF0, 0xD0, 0xB0,
+		0xFC, 0xE0, 0xA8,
+		0xF8, 0xD8, 0x78,
+		0xD8, 0xF8, 0x78,
+		0xB8, 0xF8, 0xB8,
+		0xB8, 0xF8, 0xD8,
+		0x00, 0xFC, 0xFC,
+		0xF8, 0xD8, 0xF8,
+		0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00
+	};
+
+	const int frameWidth = 256;
+	const int frameHeight = 240;
+
+	//Each emphasis bit darkens the two channels it doesn't emphasise
+	uint8_t attenuate(uint8_t channel)
+	{
+		return channel * 816 / 1000;
+	}
+}
+
+Palette::Palette()
+{
+	for(int emphasis = 0; emphasis < 8; ++emphasis)
+	{
+		for(int i = 0; i < 64; ++i)
+		{
+			RGB color;
+			color.R = defaultPalette[i * 3];
+			color.G = defaultPalette[i * 3 + 1];
+			color.B = defaultPalette[i * 3 + 2];
+
+			if(emphasis & 0x01) //Red
+			{
+				color.G = attenuate(color.G);
+				color.B = attenuate(color.B);
+			}
+			if(emphasis & 0x02) //Green
+			{
+				color.R = attenuate(color.R);
+				color.B = attenuate(color.B);
+			}
+			if(emphasis & 0x04) //Blue
+			{
+				color.R = attenuate(color.R);
+				color.G = attenuate(color.G);
+			}
+
+			colors[emphasis][i] = color;
+			uint8_t bytes[4] = {color.R, color.G, color.B, 0xFF};
+			std::memcpy(&packed32[emphasis][i], bytes, 4);
+			uint8_t swapped[4] = {color.B, color.G, color.R, 0xFF};
+			std::memcpy(&packedBGRA[emphasis][i], swapped, 4);
+			packed565[emphasis][i] = ((color.R >> 3) << 11) | ((color.G >> 2) << 5) | (color.B >> 3);
+		}
+	}
+}
+
+RGB Palette::color(uint8_t index, uint8_t emphasis) const
+{
+	return colors[emphasis & 0x07][index & 0x3F];
+}
+
+void Palette::convert(const uint8_t* indices, const uint8_t* emphasis, PixelFormat format, void* pixels, int pitch) const
+{
+	static const bool avx2 = hasAVX2();
+	if(avx2)
+		convertAVX2(indices, emphasis, format, (uint8_t*)pixels, pitch);
+	else
+		convertScalar(indices, emphasis, format, (uint8_t*)pixels, pitch);
+}
+
+void Palette::convertScalar(const uint8_t* indices, const uint8_t* emphasis, PixelFormat format, uint8_t* pixels, int pitch) const
+{
+	for(int y = 0; y < frameHeight; ++y)
+	{
+		const uint8_t* in = indices + y * frameWidth;
+		uint8_t* out = pixels + y * pitch;
+		int e = emphasis[y] & 0x07;
+
+		switch(format)
+		{
+			case RGB24:
+				for(int x = 0; x < frameWidth; ++x)
+				{
+					const RGB& color = colors[e][in[x] & 0x3F];
+					out[x * 3] = color.R;
+					out[x * 3 + 1] = color.G;
+					out[x * 3 + 2] = color.B;
+				}
+				break;
+			case RGBA32:
+			case BGRA32:
+			{
+				const uint32_t* table = (format == RGBA32) ? packed32[e] : packedBGRA[e];
+				for(int x = 0; x < frameWidth; ++x)
+					std::memcpy(out + x * 4, &table[in[x] & 0x3F], 4);
+				break;
+			}
+			case RGB565:
+				for(int x = 0; x < frameWidth; ++x)
+				{
+					uint16_t color = packed565[e][in[x] & 0x3F];
+					std::memcpy(out + x * 2, &color, 2);
+				}
+				break;
+		}
+	}
+}
+
+#ifdef PALETTE_X86
+__attribute__((target("avx2")))
+void Palette::convertAVX2(const uint8_t* indices, const uint8_t* emphasis, PixelFormat format, uint8_t* pixels, int pitch) const
+{
+	//Eight pixels at a time: widen the indices to 32 bits and gather their colors from the packed table
+	const __m256i indexMask = _mm256_set1_epi32(0x3F);
+	const __m256i rgbShuffle = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+												0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+	for(int y = 0; y < frameHeight; ++y)
+	{
+		const uint8_t* in = indices + y * frameWidth;
+		uint8_t* out = pixels + y * pitch;
+		int e = emphasis[y] & 0x07;
+		const int* table = (const int*)(format == RGB565 ? packed565[e] : format == BGRA32 ? packedBGRA[e] : packed32[e]);
+
+		//The last group of an RGB24 row would store 4 bytes past the row, so it's left to the scalar loop
+		int vectorWidth = (format == RGB24) ? frameWidth - 8 : frameWidth;
+		int x = 0;
+		for(; x < vectorWidth; x += 8)
+		{
+			__m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(in + x)));
+			__m256i color = _mm256_i32gather_epi32(table, _mm256_and_si256(index, indexMask), 4);
+
+			switch(format)
+			{
+				case RGB24:
+				{
+					__m256i rgb = _mm256_shuffle_epi8(color, rgbShuffle);
+					_mm_storeu_si128((__m128i*)(out + x * 3), _mm256_castsi256_si128(rgb));
+					_mm_storeu_si128((__m128i*)(out + x * 3 + 12), _mm256_extracti128_si256(rgb, 1));
+					break;
+				}
+				case RGBA32:
+				case BGRA32:
+					_mm256_storeu_si256((__m256i*)(out + x * 4), color);
+					break;
+				case RGB565:
+				{
+					__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(color, color), 0x08);
+					_mm_storeu_si128((__m128i*)(out + x * 2), _mm256_castsi256_si128(packed));
+					break;
+				}
+			}
+		}
+
+		for(; x < frameWidth; ++x)
+		{
+			const RGB& color = colors[e][in[x] & 0x3F];
+			out[x * 3] = color.R;
+			out[x * 3 + 1] = color.G;
+			out[x * 3 + 2] = color.B;
+		}
+	}
+}
+
+bool Palette::hasAVX2()
+{
+	return __builtin_cpu_supports("avx2");
+}
+#else
+void Palette::convertAVX2(const uint8_t* indices, const uint8_t* emphasis, PixelFormat format, uint8_t* pixels, int pitch) const
+{
+	convertScalar(indices, emphasis, format, pixels, pitch);
+}
+
+bool Palette::hasAVX2()
+{
+	return false;
+}
+#endif
+
+Palette::~Palette()
+{
+
+}
@@ -0,0 +1,249 @@
+#include "include/Rewind.hpp"
+#include <cstring>
+
+namespace
+{
+	void writeLength(uint8_t*& out, size_t value)
+	{
+		while(value >= 0x80)
+		{
+			*out++ = (value & 0x7F) | 0x80;
+			value >>= 7;
+		}
+		*out++ = value;
+	}
+
+	size_t readLength(const uint8_t*& in)
+	{
+		size_t value = 0;
+		int shift = 0;
+		while(*in & 0x80)
+		{
+			value |= (size_t)(*in++ & 0x7F) << shift;
+			shift += 7;
+		}
+		value |= (size_t)(*in++) << shift;
+		return value;
+	}
+}
+
+Rewind::Rewind(size_t capacity, int keyframeInterval)
+: ring(capacity), keyframeInterval(keyframeInterval)
+{
+
+}
+
+void Rewind::push(const SaveState& state)
+{
+	size_t size = state.size();
+
+	//A different machine (or format) can't be a delta of what's stored
+	if(size != keyframeState.size())
+	{
+		clear();
+		keyframeState.assign(size, 0);
+		zeros.assign(size, 0);
+		scratch.resize(size * 2 + 16);
+	}
+
+	//Deltas continue the newest entry's group until the group is keyframeInterval long
+	bool keyframe = entries.empty() || entries.back().sequence - entries.back().keyframe + 1 >= (uint64_t)keyframeInterval;
+	if(!keyframe)
+		loadKeyframe(entries.back().keyframe);
+
+	size_t encodedSize = encode(state.data(), keyframe ? zeros.data() : keyframeState.data(), size, scratch.data());
+	if(encodedSize > ring.size())
+		return;
+
+	//The group has to be read before allocating, which may drop every entry
+	Entry entry;
+	entry.sequence = nextSequence++;
+	entry.keyframe = keyframe ? entry.sequence : entries.back().keyframe;
+	entry.offset = allocate(encodedSize);
+	entry.size = encodedSize;
+	std::memcpy(ring.data() + entry.offset, scratch.data(), encodedSize);
+
+	//Making room may have dropped this entry's keyframe, in which case it becomes the keyframe itself. The delta was the last
+	//allocation, so handing its space back first is just moving head back to it
+	if(!keyframe && (entries.empty() || entries.front().sequence > entry.keyframe))
+	{
+		head = entry.offset;
+		keyframe = true;
+		entry.size = encode(state.data(), zeros.data(), size, scratch.data());
+		if(entry.size > ring.size())
+		{
+			--nextSequence;
+			return;
+		}
+		entry.offset = allocate(entry.size);
+		entry.keyframe = entry.sequence;
+		std::memcpy(ring.data() + entry.offset, scratch.data(), entry.size);
+	}
+
+	entries.push_back(entry);
+	if(keyframe)
+	{
+		std::memcpy(keyframeState.data(), state.data(), size);
+		keyframeSequence = entry.sequence;
+	}
+}
+
+bool Rewind::pop(SaveState& state)
+{
+	if(entries.empty())
+		return false;
+
+	Entry entry = entries.back();
+	loadKeyframe(entry.keyframe);
+
+	std::vector<uint8_t>& out = scratch;
+	decode(ring.data() + entry.offset, entry.size, entry.sequence == entry.keyframe ? zeros.data() : keyframeState.data(),
+	       keyframeState.size(), out.data());
+	state.assign(out.data(), keyframeState.size());
+
+	//The next push reuses this entry's sequence number and space
+	entries.pop_back();
+	head = entries.empty() ? 0 : entries.back().offset + entries.back().size;
+	nextSequence = entry.sequence;
+	if(keyframeSequence == entry.sequence)
+		keyframeSequence = UINT64_MAX;
+	return true;
+}
+
+size_t Rewind::bytesUsed() const
+{
+	size_t total = 0;
+	for(const Entry& entry : entries)
+		total += entry.size;
+	return total;
+}
+
+void Rewind::clear()
+{
+	entries.clear();
+	head = 0;
+	keyframeSequence = UINT64_MAX;
+}
+
+const Rewind::Entry* Rewind::findEntry(uint64_t sequence) const
+{
+	//Sequence numbers are consecutive, so this is an index lookup
+	if(entries.empty() || sequence < entries.front().sequence || sequence > entries.back().sequence)
+		return nullptr;
+	return &entries[sequence - entries.front().sequence];
+}
+
+void Rewind::loadKeyframe(uint64_t sequence)
+{
+	if(sequence == keyframeSequence)
+		return;
+
+	const Entry* entry = findEntry(sequence);
+	decode(ring.data() + entry->offset, entry->size, zeros.data(), keyframeState.size(), keyframeState.data());
+	keyframeSequence = sequence;
+}
+
+size_t Rewind::allocate(size_t size)
+{
+	//Entries are contiguous, an entry that doesn't fit before the end of the ring starts over at the beginning
+	size_t offset = head;
+	if(offset + size > ring.size())
+	{
+		//Whatever is left of the previous lap lies past the head and is older than anything at the start of the ring, it has
+		//to go before the front of the queue can be the entry at offset 0
+		while(!entries.empty() && entries.front().offset >= head)
+			dropOldest();
+		offset = 0;
+	}
+
+	//Drop whatever still occupies [offset, offset + size)
+	while(!entries.empty())
+	{
+		const Entry& oldest = entries.front();
+		bool overlaps = oldest.offset < offset + size && offset < oldest.offset + oldest.size;
+		if(!overlaps)
+			break;
+		dropOldest();
+	}
+
+	head = offset + size;
+	return offset;
+}
+
+void Rewind::dropOldest()
+{
+	//Deltas are useless without their keyframe, so the rest of the group goes too
+	uint64_t keyframe = entries.front().keyframe;
+	entries.pop_front();
+	while(!entries.empty() && entries.front().keyframe == keyframe)
+		entries.pop_front();
+
+	if(keyframeSequence == keyframe)
+		keyframeSequence = UINT64_MAX;
+}
+
+size_t Rewind::encode(const uint8_t* state, const uint8_t* base, size_t size, uint8_t* out)
+{
+	//Pairs of (unchanged run length, changed run length) followed by the changed bytes XORed with the base.
+	//Short unchanged gaps are folded into the changed run since a new pair would cost more than it saves
+	const size_t minimumGap = 4;
+	uint8_t* start = out;
+	size_t i = 0;
+
+	while(i < size)
+	{
+		size_t same = i;
+		while(same + 8 <= size && std::memcmp(state + same, base + same, 8) == 0)
+			same += 8;
+		while(same < size && state[same] == base[same])
+			++same;
+
+		size_t changed = same;
+		while(changed < size)
+		{
+			if(state[changed] != base[changed])
+			{
+				++changed;
+				continue;
+			}
+
+			size_t gap = changed;
+			while(gap < size && gap - changed < minimumGap && state[gap] == base[gap])
+				++gap;
+			if(gap - changed >= minimumGap || gap == size)
+				break;
+			changed = gap;
+		}
+
+		writeLength(out, same - i);
+		writeLength(out, changed - same);
+		for(size_t j = same; j < changed; ++j)
+			*out++ = state[j] ^ base[j];
+
+		i = changed;
+	}
+
+	return out - start;
+}
+
+void Rewind::decode(const uint8_t* in, size_t inSize, const uint8_t* base, size_t size, uint8_t* out)
+{
+	std::memcpy(out, base, size);
+
+	const uint8_t* end = in + inSize;
+	size_t position = 0;
+	while(in < end)
+	{
+		position += readLength(in);
+		size_t changed = readLength(in);
+		for(size_t j = 0; j < changed; ++j)
+			out[position + j] ^= in[j];
+		in += changed;
+		position += changed;
+	}
+}
+
+Rewind::~Rewind()
+{
+
+}
@@ -0,0 +1,119 @@
+#include "include/RomCache.hpp"
+#include <cstring>
+#include <iterator>
+#include <sys/stat.h>
+
+RomCache::RomCache()
+{
+
+}
+
+std::shared_ptr<const RomImage> RomCache::load(const char* path)
+{
+	//Size and modification time tell a path that still holds what was loaded from it, without mapping or hashing it again.
+	//A path that can't be stat'ed skips the shortcut and lets RomImage report the error
+	struct stat info;
+	bool known = stat(path, &info) == 0;
+	if(known)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		auto entry = paths.find(path);
+		if(entry != paths.end() && entry->second.size == (long long)info.st_size && entry->second.modified == (long long)info.st_mtime)
+		{
+			if(std::shared_ptr<const RomImage> cached = entry->second.image.lock())
+				return cached;
+		}
+	}
+
+	//Mapping and hashing happen outside the lock, only the lookup is serialized. A freshly mapped duplicate is simply dropped
+	std::shared_ptr<const RomImage> image = std::make_shared<const RomImage>(path);
+	uint64_t hash = contentHash(*image);
+
+	std::lock_guard<std::mutex> guard(lock);
+	prune();
+	std::shared_ptr<const RomImage> result;
+	std::vector<std::weak_ptr<const RomImage>>& candidates = images[hash];
+	for(const std::weak_ptr<const RomImage>& weak : candidates)
+	{
+		std::shared_ptr<const RomImage> cached = weak.lock();
+		if(cached && cached->size() == image->size() && std::memcmp(cached->data(), image->data(), image->size()) == 0)
+		{
+			result = cached;
+			break;
+		}
+	}
+
+	if(!result)
+	{
+		candidates.push_back(image);
+		result = image;
+	}
+	if(known)
+		paths[path] = PathEntry{(long long)info.st_size, (long long)info.st_mtime, result};
+	return result;
+}
+
+size_t RomCache::size() const
+{
+	std::lock_guard<std::mutex> guard(lock);
+	size_t count = 0;
+	for(const auto& entry : images)
+	{
+		for(const std::weak_ptr<const RomImage>& weak : entry.second)
+			count += !weak.expired();
+	}
+	return count;
+}
+
+void RomCache::clear()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	paths.clear();
+	images.clear();
+}
+
+void RomCache::prune()
+{
+	//Drops the bookkeeping of images nobody holds anymore, only called with the lock held
+	for(auto entry = images.begin(); entry != images.end();)
+	{
+		std::vector<std::weak_ptr<const RomImage>>& candidates = entry->second;
+		for(size_t i = 0; i < candidates.size();)
+		{
+			if(candidates[i].expired())
+			{
+				candidates[i] = candidates.back();
+				candidates.pop_back();
+			}
+			else
+				++i;
+		}
+		entry = candidates.empty() ? images.erase(entry) : std::next(entry);
+	}
+	for(auto entry = paths.begin(); entry != paths.end();)
+		entry = entry->second.image.expired() ? paths.erase(entry) : std::next(entry);
+}
+
+uint64_t RomCache::contentHash(const RomImage& image)
+{
+	//Eight bytes per step, each word multiplied in and folded down so every bit reaches the result
+	const uint8_t* bytes = image.data();
+	size_t size = image.size();
+	uint64_t hash = 0x9E3779B97F4A7C15ull ^ size;
+	size_t i = 0;
+	for(; i + 8 <= size; i += 8)
+	{
+		uint64_t word;
+		std::memcpy(&word, bytes + i, 8);
+		hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 32;
+	}
+	for(; i < size; ++i)
+		hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+	return hash;
+}
+
+RomCache::~RomCache()
+{
+
+}
@@ -0,0 +1,98 @@
+#include "include/RomImage.hpp"
+#include <cstring>
+#include <fstream>
+#include "include/Exceptions.hpp"
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+RomImage::RomImage(const char* path)
+{
+#if !defined(_WIN32)
+	int fd = open(path, O_RDONLY);
+	if(fd < 0)
+		throw ROMFileError("Could not open ROM", path);
+
+	struct stat info;
+	if(fstat(fd, &info) == 0 && info.st_size > 0)
+	{
+		void* view = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(view != MAP_FAILED)
+		{
+			bytes = (const uint8_t*)view;
+			length = info.st_size;
+			mapped = true;
+		}
+	}
+	close(fd);
+#endif
+
+	if(!mapped)
+		readFile(path);
+
+	try
+	{
+		decodeHeader(path);
+	}
+	catch(...)
+	{
+		unmap();
+		throw;
+	}
+}
+
+void RomImage::readFile(const char* path)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if(!file)
+		throw ROMFileError("Could not open ROM", path);
+
+	buffer.resize((size_t)file.tellg());
+	file.seekg(0);
+	if(!file.read((char*)buffer.data(), buffer.size()))
+		throw ROMFileError("Could not read ROM", path);
+
+	bytes = buffer.data();
+	length = buffer.size();
+}
+
+void RomImage::decodeHeader(const char* path)
+{
+	if(length < 16 || std::memcmp(bytes, "NES\x1A", 4) != 0)
+		throw ROMFileError("Not an iNES ROM", path);
+
+	headerData.PRG_ROM_SIZE = bytes[4];
+	headerData.CHR_ROM_SIZE = bytes[5];
+	headerData.Flags6 = bytes[6];
+	headerData.Flags7 = bytes[7];
+	headerData.Flags8 = bytes[8];
+	headerData.Flags9 = bytes[9];
+	headerData.Flags10 = bytes[10];
+
+	if(headerData.PRG_ROM_SIZE == 0)
+		throw ROMFileError("ROM has no PRG ROM", path);
+
+	//A 512 byte trainer sits between the header and PRG ROM
+	if(headerData.Flags6 & 0x04)
+		prgOffset += 512;
+
+	if(prgOffset + PRGSize() + CHRSize() > length)
+		throw ROMFileError("ROM is shorter than its header says", path);
+}
+
+void RomImage::unmap()
+{
+#if !defined(_WIN32)
+	if(mapped)
+		munmap((void*)bytes, length);
+#endif
+	mapped = false;
+}
+
+RomImage::~RomImage()
+{
+	unmap();
+}
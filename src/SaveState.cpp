@@ -0,0 +1,59 @@
+#include "include/SaveState.hpp"
+#include "include/Exceptions.hpp"
+
+SaveState::SaveState()
+{
+
+}
+
+void SaveState::beginMeasure()
+{
+	mode = measuring;
+	position = headerSize;
+}
+
+void SaveState::beginSave(size_t payloadSize)
+{
+	mode = saving;
+	if(buffer.size() != headerSize + payloadSize)
+		buffer.resize(headerSize + payloadSize);
+
+	uint32_t fields[2] = {version, (uint32_t)payloadSize};
+	std::memcpy(buffer.data(), "NESS", 4);
+	std::memcpy(buffer.data() + 4, fields, 8);
+	position = headerSize;
+}
+
+void SaveState::beginLoad(size_t payloadSize)
+{
+	uint32_t fields[2] = {0, 0};
+	if(buffer.size() < headerSize || std::memcmp(buffer.data(), "NESS", 4) != 0)
+		throw InvalidSaveState("Not a save state");
+
+	std::memcpy(fields, buffer.data() + 4, 8);
+	if(fields[0] != version)
+		throw InvalidSaveState("Save state is from an incompatible version");
+	if(headerSize + fields[1] != buffer.size())
+		throw InvalidSaveState("Save state is truncated");
+	if(fields[1] != payloadSize)
+		throw InvalidSaveState("Save state doesn't match this machine");
+
+	mode = loading;
+	position = headerSize;
+}
+
+void SaveState::finish()
+{
+	if(mode != measuring && position != buffer.size())
+		throw InvalidSaveState("Save state doesn't match this machine");
+}
+
+void SaveState::assign(const uint8_t* bytes, size_t size)
+{
+	buffer.assign(bytes, bytes + size);
+}
+
+SaveState::~SaveState()
+{
+
+}
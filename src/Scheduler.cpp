@@ -0,0 +1,63 @@
+#include "include/Scheduler.hpp"
+
+Scheduler::Scheduler()
+{
+	for(int i = 0; i < eventCount; ++i)
+		timestamps[i] = never;
+}
+
+void Scheduler::setHandler(ScheduledEvent event, std::function<void(uint64_t now)> handler)
+{
+	handlers[event] = handler;
+}
+
+void Scheduler::schedule(ScheduledEvent event, uint64_t timestamp)
+{
+	timestamps[event] = timestamp;
+	findNext();
+}
+
+void Scheduler::cancel(ScheduledEvent event)
+{
+	timestamps[event] = never;
+	findNext();
+}
+
+void Scheduler::serialize(SaveState& state)
+{
+	state.block(timestamps, sizeof(timestamps));
+	if(state.isLoading())
+		findNext();
+}
+
+void Scheduler::dispatch(uint64_t now)
+{
+	//Handlers may schedule further events, including ones that are already due
+	while(next <= now)
+	{
+		ScheduledEvent event = nextEvent;
+		timestamps[event] = never;
+		findNext();
+
+		if(handlers[event])
+			handlers[event](now);
+	}
+}
+
+void Scheduler::findNext()
+{
+	next = never;
+	for(int i = 0; i < eventCount; ++i)
+	{
+		if(timestamps[i] < next)
+		{
+			next = timestamps[i];
+			nextEvent = static_cast<ScheduledEvent>(i);
+		}
+	}
+}
+
+Scheduler::~Scheduler()
+{
+
+}
@@ -0,0 +1,76 @@
+#include "include/TileCache.hpp"
+
+constexpr std::array<uint64_t, 256> TileCache::buildSpread(bool flipped)
+{
+	std::array<uint64_t, 256> table = {};
+	for(int value = 0; value < 256; ++value)
+		for(int pixel = 0; pixel < 8; ++pixel)
+		{
+			int bit = flipped ? pixel : 7 - pixel;
+			table[value] |= (uint64_t)((value >> bit) & 0x01) << (pixel * 8);
+		}
+	return table;
+}
+
+const std::array<uint64_t, 256> TileCache::spread = TileCache::buildSpread(false);
+const std::array<uint64_t, 256> TileCache::spreadFlipped = TileCache::buildSpread(true);
+
+TileCache::TileCache(Cartridge& cartridge) : cart(cartridge)
+{
+	for(int i = 0; i < rowCount; ++i)
+		stamps[i] = 0;
+	chrGeneration = cart.chrGeneration();
+}
+
+const TileCache::Row& TileCache::row(uint16_t address)
+{
+	//A bank switch can change every row at once, so it just moves the cache on to a new generation
+	if(cart.chrGeneration() != chrGeneration)
+	{
+		chrGeneration = cart.chrGeneration();
+		if(++generation == 0)
+		{
+			for(int i = 0; i < rowCount; ++i)
+				stamps[i] = 0;
+			generation = 1;
+		}
+	}
+
+	int i = index(address);
+	if(stamps[i] != generation)
+	{
+		uint16_t base = address & 0x1FF7;
+		rows[i].low = cart.readCHR(base);
+		rows[i].high = cart.readCHR(base | 0x08);
+		rows[i].pixels = decode(rows[i].low, rows[i].high);
+		rows[i].flipped = decodeFlipped(rows[i].low, rows[i].high);
+		stamps[i] = generation;
+	}
+	return rows[i];
+}
+
+void TileCache::invalidate(uint16_t address)
+{
+	stamps[index(address)] = 0;
+}
+
+void TileCache::clear()
+{
+	for(int i = 0; i < rowCount; ++i)
+		stamps[i] = 0;
+}
+
+uint64_t TileCache::decode(uint8_t low, uint8_t high)
+{
+	return spread[low] | (spread[high] << 1);
+}
+
+uint64_t TileCache::decodeFlipped(uint8_t low, uint8_t high)
+{
+	return spreadFlipped[low] | (spreadFlipped[high] << 1);
+}
+
+TileCache::~TileCache()
+{
+
+}
@@ -0,0 +1,75 @@
+#include "include/Trace.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include "include/Exceptions.hpp"
+
+Trace::Trace(size_t capacity)
+{
+	size_t size = 1;
+	while(size < capacity)
+		size <<= 1;
+	entries.resize(size);
+	mask = size - 1;
+}
+
+const TraceEntry& Trace::operator[](size_t i) const
+{
+	return entries[(recorded - size() + i) & mask];
+}
+
+void Trace::clear()
+{
+	recorded = 0;
+}
+
+void Trace::save(const char* path) const
+{
+	std::ofstream file(path, std::ios::binary);
+	if(!file)
+		throw TraceFileError("Could not open trace file for writing", path);
+
+	uint32_t version = fileVersion;
+	uint64_t count = size();
+	file.write("NTRC", 4);
+	file.write((const char*)&version, sizeof(version));
+	file.write((const char*)&count, sizeof(count));
+
+	//The ring is stored oldest first, which is at most two contiguous runs
+	size_t start = (recorded - count) & mask;
+	size_t firstRun = std::min<size_t>(count, entries.size() - start);
+	file.write((const char*)&entries[start], firstRun * sizeof(TraceEntry));
+	file.write((const char*)&entries[0], (count - firstRun) * sizeof(TraceEntry));
+}
+
+void Trace::load(const char* path)
+{
+	std::ifstream file(path, std::ios::binary);
+	char tag[4];
+	uint32_t version = 0;
+	uint64_t count = 0;
+	file.read(tag, 4);
+	file.read((char*)&version, sizeof(version));
+	file.read((char*)&count, sizeof(count));
+	if(!file || std::memcmp(tag, "NTRC", 4) != 0 || version != fileVersion)
+		throw TraceFileError("Not a trace file", path);
+
+	//The count has to agree with what the file actually holds before anything is allocated for it
+	std::streamoff header = file.tellg();
+	file.seekg(0, std::ios::end);
+	std::streamoff payload = file.tellg() - header;
+	file.seekg(header);
+	if(payload < 0 || count != (uint64_t)payload / sizeof(TraceEntry) || payload % sizeof(TraceEntry) != 0)
+		throw TraceFileError("Trace file size doesn't match its entry count", path);
+
+	*this = Trace(count);
+	file.read((char*)entries.data(), count * sizeof(TraceEntry));
+	if(!file || (uint64_t)file.gcount() != count * sizeof(TraceEntry))
+		throw TraceFileError("Trace file is truncated", path);
+	recorded = count;
+}
+
+Trace::~Trace()
+{
+
+}
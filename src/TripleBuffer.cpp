@@ -0,0 +1,27 @@
+#include "include/TripleBuffer.hpp"
+
+TripleBuffer::TripleBuffer(size_t frameSize) : middle(1)
+{
+	for(std::vector<uint8_t>& buffer : buffers)
+		buffer.resize(frameSize);
+}
+
+void TripleBuffer::publish()
+{
+	//Release makes the frame's contents visible to the consumer that picks up this index
+	backIndex = middle.exchange(backIndex | fresh, std::memory_order_acq_rel) & 0x03;
+}
+
+bool TripleBuffer::acquire()
+{
+	if(!(middle.load(std::memory_order_relaxed) & fresh))
+		return false;
+
+	frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & 0x03;
+	return true;
+}
+
+TripleBuffer::~TripleBuffer()
+{
+
+}
@@ -1,14 +1,37 @@
 #ifndef APU_HPP
 #define APU_HPP
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include "Cartridge.hpp"
+#include "BlipBuffer.hpp"
+#include "Scheduler.hpp"
+#include "SaveState.hpp"
 
+//Channels aren't stepped every cycle. Each one jumps from one timer clock to the next and only tells the blip buffer
+//when its level changes, so the cost follows the notes being played rather than the clock rate. Runs are split at frame
+//sequencer steps because envelopes, sweeps and length counters change what the channels put out. Silent channels are
+//left behind and skip their missed clocks in one go the next time the APU really has to run.
+//
+//Nothing runs the APU every cycle either. It catches up when its registers are accessed, when a mapper write could switch
+//the bank DMC samples come from, and when a frame's audio is collected. Interrupts are predicted instead, the scheduler's
+//apuFrameIRQ event is kept at the cycle the next frame or DMC IRQ is raised
 class APU
 {
 public:
-    APU();
-    uint8_t readMemMappedReg(uint16_t address) const;
+    APU(Cartridge& cartridge, Scheduler& scheduler);
+    uint8_t readMemMappedReg(uint16_t address);
     void writeMemMappedReg(uint16_t address, uint8_t data);
+    void runUntil(uint64_t end) { if(end < nextEvent) cycle = std::max(cycle, end); else run(end); } //end is a CPU cycle
+    bool IRQ() const { return frameIRQ || dmc.irq; }
+    void endFrame(uint64_t cycle); //Runs up to cycle and makes the audio so far readable
+    size_t samplesAvailable() const { return blip.samplesAvailable(); }
+    size_t readSamples(int16_t* out, size_t count);
+    void setSampleRate(int rate);
+    void adjustSampleRate(double ratio) { blip.adjustRate(ratio); }
+    void setOutputEnabled(bool enabled);
+    void serialize(SaveState& state);
     ~APU();
 
 private:
@@ -38,6 +61,125 @@ private:
         uint8_t JOY2 = 0x00;
     };
     APU_Registers reg;
+    Cartridge& cart;
+    Scheduler& scheduler;
+
+    struct Envelope
+    {
+        bool start = false;
+        bool loop = false;      //Also the length counter halt flag
+        bool constant = false;
+        uint8_t period = 0;     //Doubles as the constant volume
+        uint8_t divider = 0;
+        uint8_t decay = 0;
+        void serialize(SaveState& state);
+    };
+
+    struct Pulse
+    {
+        Envelope envelope;
+        uint8_t duty = 0;
+        uint8_t phase = 0;
+        uint16_t timer = 0;
+        uint8_t length = 0;
+        bool sweepEnabled = false, sweepNegate = false, sweepReload = false;
+        uint8_t sweepPeriod = 0, sweepShift = 0, sweepDivider = 0;
+        uint64_t next = 0;      //CPU cycle of the next timer clock
+        int output = 0;         //Level last sent to the blip buffer
+        void serialize(SaveState& state);
+    };
+
+    struct Triangle
+    {
+        bool control = false;
+        uint8_t linearReload = 0, linearCounter = 0;
+        bool linearReloadFlag = false;
+        uint16_t timer = 0;
+        uint8_t length = 0;
+        uint8_t phase = 0;
+        uint64_t next = 0;
+        int output = 0;
+        void serialize(SaveState& state);
+    };
+
+    struct Noise
+    {
+        Envelope envelope;
+        bool shortMode = false;
+        uint8_t periodIndex = 0;
+        uint16_t shifter = 1;
+        uint8_t length = 0;
+        uint64_t next = 0;
+        int output = 0;
+        void serialize(SaveState& state);
+    };
+
+    struct DMC
+    {
+        bool irqEnabled = false, loop = false, irq = false;
+        uint8_t rateIndex = 0;
+        uint8_t level = 0;
+        uint16_t sampleAddress = 0xC000, sampleLength = 1;
+        uint16_t address = 0xC000, bytesRemaining = 0;
+        uint8_t sampleBuffer = 0;
+        bool bufferEmpty = true;
+        uint8_t shifter = 0, bitsRemaining = 8;
+        bool silence = true;
+        uint64_t next = 0;
+        int output = 0;
+        void serialize(SaveState& state);
+    };
+
+    Pulse pulse1, pulse2;
+    Triangle triangle;
+    Noise noise;
+    DMC dmc;
+    uint8_t enabled = 0x00; //$4015 channel enables
+
+    //Frame sequencer
+    bool fiveStep = false, irqInhibit = false, frameIRQ = false;
+    int frameStep = 0;
+    uint64_t sequenceStart = 0, nextFrameStep = 0;
+    void resetSequence();
+    void clockFrameSequencer();
+    void quarterFrame();
+    void halfFrame();
+
+    //Everything is in CPU cycles since power up. Nothing audible or able to raise an IRQ happens before nextEvent
+    uint64_t cycle = 0, nextEvent = 0;
+    void run(uint64_t end);
+    void updateNextEvent();
+    void scheduleIRQ();
+    void closeFrame();
+    void runChannels(uint64_t end);
+    void runPulse(Pulse& pulse, bool onesComplement, uint64_t end);
+    void runTriangle(uint64_t end);
+    void runNoise(uint64_t end);
+    void runDMC(uint64_t end);
+    void fetchSample();
+    void restartSample();
+
+    void writeEnvelope(Envelope& envelope, uint8_t data);
+    void clockEnvelope(Envelope& envelope);
+    uint8_t envelopeVolume(const Envelope& envelope) const;
+    uint16_t sweepTarget(const Pulse& pulse, bool onesComplement) const;
+    void clockSweep(Pulse& pulse, bool onesComplement);
+    bool sweepMuted(const Pulse& pulse, bool onesComplement) const;
+    int pulseVolume(const Pulse& pulse, bool onesComplement) const;
+    int noiseVolume() const;
+
+    //Output, linear approximations of the mixer's weights in 1/32768ths. Not part of the saved state: blipLevel is what the
+    //buffer was last told, the channels' own output fields keep tracking while output is off and get reconciled with it
+    static constexpr double clockRate = 1789773.0;
+    static const int pulseWeight = 246, triangleWeight = 279, noiseWeight = 162, dmcWeight = 110;
+    static const uint32_t maxFrameCycles = 65536; //Frames are closed early when nobody calls endFrame
+    BlipBuffer blip;
+    uint64_t frameStart = 0;
+    int blipLevel = 0;
+    bool outputEnabled = true;
+    void setLevel(int& output, int level, int weight, uint64_t time);
+    void updateLevels();
+    void syncOutput();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,32 @@
+#ifndef AUDIORING_HPP
+#define AUDIORING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Moves samples from one producer thread to one consumer thread without locks, for feeding an audio callback that must
+//never wait. Each side only advances its own index and reads the other's, so a full ring drops what doesn't fit and an
+//empty one hands back fewer samples than asked for
+class AudioRing
+{
+public:
+	AudioRing(size_t capacity); //Rounded up to a power of two
+	size_t write(const int16_t* samples, size_t count); //Producer side, returns how many fitted
+	size_t read(int16_t* samples, size_t count);        //Consumer side, returns how many there were
+	size_t size() const;                                //Either side, samples waiting to be read
+	size_t capacity() const { return mask + 1; }
+	~AudioRing();
+
+private:
+	std::vector<int16_t> buffer;
+	size_t mask;
+
+	//Free running counts of samples written and read, wrapped into the buffer with mask. Kept on separate cache lines so
+	//the two threads don't keep stealing each other's
+	alignas(64) std::atomic<size_t> writeCount;
+	alignas(64) std::atomic<size_t> readCount;
+};
+
+#endif
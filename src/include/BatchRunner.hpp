@@ -0,0 +1,46 @@
+#ifndef BATCHRUNNER_HPP
+#define BATCHRUNNER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Types.hpp"
+#include "RomCache.hpp"
+
+//One emulation session: a ROM run for a number of frames from power up
+struct BatchJob
+{
+	std::string romPath;
+	long frames = 0;
+	std::vector<uint8_t> movie; //Controller one input for each frame, frames past the end get no input
+	ExecutionMode mode = cycleStepped;
+};
+
+struct BatchResult
+{
+	bool ok = false;
+	std::string error;   //What was thrown when ok is false
+	uint64_t cycles = 0;
+	uint64_t frameHash = 0; //FNV-1a of the last frame as RGB24, for comparing runs
+	double seconds = 0.0;
+};
+
+//Runs independent sessions on a pool of worker threads. Every session gets its own NES, the only thing they share is the
+//read-only ROM image of the game they run, so workers never wait on each other after taking the next job index. On Linux
+//each worker is pinned to its own core
+class BatchRunner
+{
+public:
+	BatchRunner(unsigned threads = 0); //0 uses every hardware thread
+	std::vector<BatchResult> run(const std::vector<BatchJob>& jobs);
+	unsigned threadCount() const { return threads; }
+	~BatchRunner();
+
+private:
+	unsigned threads;
+	RomCache roms;
+	BatchResult runJob(const BatchJob& job, std::vector<uint8_t>& pixels);
+	static void pinToCore(unsigned core);
+};
+
+#endif
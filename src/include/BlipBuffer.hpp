@@ -0,0 +1,66 @@
+#ifndef BLIPBUFFER_HPP
+#define BLIPBUFFER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Band-limited step synthesis. Sound sources don't produce samples, they report when their level changes and by how much.
+//Each change is added to the buffer as a short windowed-sinc step placed at its exact sub-sample position, and reading
+//integrates the buffer into samples. The cost depends on how often levels change, not on the clock rate.
+//
+//Samples go through the NES's own output filters on the way out: high-passes at 90Hz and 440Hz and a low-pass at 14kHz
+class BlipBuffer
+{
+public:
+	BlipBuffer(double clockRate, int sampleRate);
+	void setRates(double clockRate, int sampleRate);
+	void adjustRate(double ratio);           //Makes ratio times as many samples per clock, buffered ones are kept. Between frames only
+	void addDelta(uint32_t time, int delta); //time is in clocks since the current frame started
+	void endFrame(uint32_t duration);        //Samples up to duration clocks become readable, the next frame starts there
+	size_t samplesAvailable() const { return (size_t)(offset >> fracBits); }
+	size_t readSamples(int16_t* out, size_t count); //out may be null to drop samples
+	void clear();
+	~BlipBuffer();
+
+private:
+	static const int fracBits = 32;
+	static const int phaseBits = 5;
+	static const int phaseCount = 1 << phaseBits;
+	static const int taps = 16;
+	static const int deltaBits = 15; //Each kernel phase sums to 1 << deltaBits
+
+	double samplesPerClock = 0.0;
+	uint64_t factor = 0;  //Samples per clock after adjustment, 32.32 fixed point
+	uint64_t offset = 0;  //Position of the frame start in the buffer, 32.32 fixed point
+	int32_t integrator = 0;
+	size_t maxBuffered = 0; //Samples older than this are dropped when nobody reads them
+	std::vector<int32_t> buffer;
+
+	//One pole filters with 16 bit fractional coefficients, worked out for the sample rate
+	struct Filter
+	{
+		int32_t coefficient = 0;
+		int32_t input = 0, output = 0;
+	};
+	Filter highPass90, highPass440, lowPass14k;
+	static int32_t highPass(Filter& filter, int32_t sample);
+	static int32_t lowPass(Filter& filter, int32_t sample);
+
+	//Kernel phases as 16 bit taps for the scalar loop, and as taps zero extended to 32 bits so a 16x16 multiply-add gives
+	//whole products in each 32 bit lane
+	struct Kernel
+	{
+		alignas(32) int16_t rows[phaseCount][BlipBuffer::taps];
+		alignas(32) int32_t widened[phaseCount][BlipBuffer::taps];
+		Kernel();
+	};
+	static const Kernel& kernel();
+	bool avx2;
+	void addDeltaScalar(int32_t* out, int phase, int delta);
+	void addDeltaSSE2(int32_t* out, int phase, int delta);
+	void addDeltaAVX2(int32_t* out, int phase, int delta);
+	static bool hasAVX2();
+};
+
+#endif
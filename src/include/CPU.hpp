@@ -1,7 +1,7 @@
 #ifndef CPU_H
 #define CPU_H
+#include <array>
 #include <cstdint>
-#include <functional>
 #include <iostream>
 #include <string>
 #include "Cartridge.hpp"
@@ -10,13 +10,23 @@
 #include "PPU.hpp"
 #include "APU.hpp"
 #include "Controllers.hpp"
+#include "Scheduler.hpp"
+#include "Trace.hpp"
+#include "SaveState.hpp"
 
 class CPU
 {
 public:
-	CPU(Cartridge* cart, PPU& ppu, APU& apu, Controllers& controllers);
+	CPU(Cartridge* cart, PPU& ppu, APU& apu, Controllers& controllers, Scheduler& scheduler);
 	void reset();
 	void tick();
+	void step();
+	void syncPPU();
+	void setExecutionMode(ExecutionMode mode);
+	uint64_t elapsedCycles() const { return cycles; }
+	void setTrace(Trace* trace);
+	void setProgramCounter(uint16_t address);
+	void serialize(SaveState& state);
 	~CPU();
 
 private:
@@ -30,12 +40,22 @@ private:
 		uint8_t SR = 0x34;		//Status
 	};
 
+	//Handlers are bound at compile time: addressing modes are templated on the operation they perform
+	typedef void (CPU::*TickFunction)();
+	typedef void (CPU::*Operation)();
+	typedef bool (CPU::*Flag)();
+	typedef uint8_t CPU_Registers::*Register;
+	typedef uint8_t (CPU::*ReadHandler)(uint16_t address);
+	typedef void (CPU::*WriteHandler)(uint16_t address, uint8_t data);
+
 	Cartridge& cart;
 	CPU_Registers reg;
 	PPU& ppu;
 	APU& apu;
 	Controllers& controllers;
+	Scheduler& scheduler;
 	uint8_t RAM[0x0800];
+	ExecutionMode executionMode = cycleStepped;
 
 	//State
 	bool oddCycle;
@@ -43,8 +63,13 @@ private:
 	int cycleCount = 0;
 	uint8_t dataBus = 0x00;
 	uint16_t addressBus = 0x0000;
-	std::function<void()> tickFunction;
+	TickFunction tickFunction;
 	int totalCycles; //Used to determine when to allow writes to PPU registers
+	uint64_t cycles = 0; //Completed cycles, the PPU is caught up to three dots per cycle
+
+	//Instruction trace, only recorded while a buffer is attached
+	Trace* trace = nullptr;
+	void traceInstruction();
 
 	//DMA Transfer
 	bool dmaTransfer = false;
@@ -53,12 +78,28 @@ private:
 	uint8_t dmaLowByte;
 	uint8_t dmaData;
 	void executeDMATransfer();
+	void finishDMA();
+
+	//Interrupts, NMI and IRQ run the same sequence through different vectors
+	bool nmiLine = false;
+	uint16_t interruptVector = 0xFFFA;
+	void interrupt();
 
-	//Interrupts
-	void NMI();
+	//Memory map, one entry per 256 byte page. Pages without a direct pointer go through their handler
+	const uint8_t* readPages[0x100];
+	uint8_t* writePages[0x100];
+	ReadHandler readHandlers[0x100];
+	WriteHandler writeHandlers[0x100];
+	void buildMemoryMap();
+	uint8_t readPPU(uint16_t address);
+	void writePPU(uint16_t address, uint8_t data);
+	uint8_t readIO(uint16_t address);
+	void writeIO(uint16_t address, uint8_t data);
+	uint8_t readCartridge(uint16_t address);
+	void writeCartridge(uint16_t address, uint8_t data);
 
 	//Read/Write
-	uint8_t read(uint16_t address) const;
+	uint8_t read(uint16_t address);
 	void write(uint16_t address, uint8_t data);
 	uint8_t pop();
 	void push(uint8_t data);
@@ -83,29 +124,29 @@ private:
 	void IRQ_BRK_Vector();
 
 	//Addressing
-	void implied(std::function<void()> executeInstruction);
-	void immediate(std::function<void()> executeInstruction);
-	void zeroPage(std::function<void()> executeInstruction);
-	void zeroPageIndexed(std::function<void()> executeInstruction, const uint8_t& index);
-	void absolute(std::function<void()> executeInstruction);
-	void absoluteIndexed(std::function<void()> executeInstruction, const uint8_t& index);
-	void indirectX(std::function<void()> executeInstruction);
-	void indirectY(std::function<void()> executeInstruction);
+	template<Operation executeInstruction> void implied();
+	template<Operation executeInstruction> void immediate();
+	template<Operation executeInstruction> void zeroPage();
+	template<Operation executeInstruction, Register index> void zeroPageIndexed();
+	template<Operation executeInstruction> void absolute();
+	template<Operation executeInstruction, Register index> void absoluteIndexed();
+	template<Operation executeInstruction> void indirectX();
+	template<Operation executeInstruction> void indirectY();
 	uint16_t relativeAddress(uint8_t offset);
-	void relative(bool condition);
-	void zeroPage_Store(const uint8_t& regValue);
-	void zeroPageIndexed_Store(const uint8_t& regValue, const uint8_t& index);
-	void absolute_Store(const uint8_t& regValue);
-	void absoluteIndexed_Store(const uint8_t& regValue, const uint8_t& index);
-	void indirectX_Store(const uint8_t& regValue);
-	void indirectY_Store(const uint8_t& regValue);
+	template<Flag flag, bool condition> void relative();
+	template<Register regValue> void zeroPage_Store();
+	template<Register regValue, Register index> void zeroPageIndexed_Store();
+	template<Register regValue> void absolute_Store();
+	template<Register regValue, Register index> void absoluteIndexed_Store();
+	template<Register regValue> void indirectX_Store();
+	template<Register regValue> void indirectY_Store();
 
 	//Read-Modify-Write Addressing
-	void accumulator(std::function<void()> executeInstruction);
-	void zeroPage_RMW(std::function<void()> executeInstruction);
-	void zeroPageX_RMW(std::function<void()> executeInstruction);
-	void absolute_RMW(std::function<void()> executeInstruction);
-	void absoluteX_RMW(std::function<void()> executeInstruction);
+	template<Operation executeInstruction> void accumulator();
+	template<Operation executeInstruction> void zeroPage_RMW();
+	template<Operation executeInstruction> void zeroPageX_RMW();
+	template<Operation executeInstruction> void absolute_RMW();
+	template<Operation executeInstruction> void absoluteX_RMW();
 
 	//Instructions
 	void ADC();
@@ -113,8 +154,11 @@ private:
 	void ASL();
 	void BIT();
 	void BRK();
-	void CLR();
-	void CMP(const uint8_t& regValue);
+	void CLC();
+	void CLD();
+	void CLI();
+	void CLV();
+	template<Register regValue> void CMP();
 	void DEC();
 	void DEX();
 	void DEY();
@@ -129,6 +173,7 @@ private:
 	void LDX();
 	void LDY();
 	void LSR();
+	void NOP();
 	void ORA();
 	void PHA();
 	void PHP();
@@ -139,6 +184,9 @@ private:
 	void RTI();
 	void RTS();
 	void SBC();
+	void SEC();
+	void SED();
+	void SEI();
 	void TAX();
 	void TAY();
 	void TSX();
@@ -147,6 +195,9 @@ private:
 	void TYA();
 	
 	//Execution
+	static const std::array<TickFunction, 256> opTable;
+	static constexpr std::array<TickFunction, 256> buildOpTable();
+	void unknownOP();
 	void decodeOP();
 };
 
@@ -1,21 +1,100 @@
 #ifndef CARTRIDGE_H
 #define CARTRIDGE_H
 #include <cstdint>
-#include <fstream>
+#include <memory>
 #include "Types.hpp"
+#include "SaveState.hpp"
+#include "RomImage.hpp"
+#include "Exceptions.hpp"
 
+//The CPU and PPU read the cartridge through bank slots, 8KB of PRG for each of $8000, $A000, $C000 and $E000 and 1KB of
+//CHR for each eighth of the pattern tables. Mappers only run on writes, where they repoint the slots when a bank register
+//changes, so the cost of a read doesn't depend on the mapper. Boards with PRG RAM map an 8KB bank of it at $6000-$7FFF,
+//which the CPU reads and writes directly
 class Cartridge
 {
 public:
-	virtual uint8_t readPRG(uint16_t address) = 0;
+	uint8_t readPRG(uint16_t address) const;
 	virtual void writePRG(uint16_t address, uint8_t data) = 0;
-	virtual uint8_t readCHR(uint16_t address) = 0;
+	uint8_t readCHR(uint16_t address) const { return chrSlots[(address >> 10) & 0x07][address & 0x03FF]; }
 	virtual void writeCHR(uint16_t address, uint8_t data) = 0;
-	virtual Mirroring nametableMirroring() const = 0;
+	Mirroring nametableMirroring() const { return mirroringType; }
+	void attachMemoryMap(const uint8_t** readPages, uint8_t** writePages);
+	uint32_t chrGeneration() const { return chrBankGeneration; }
+	virtual void serialize(SaveState& state) { (void)state; } //Mappers with registers or RAM override this
 	virtual ~Cartridge() {}
 protected:
 	Mirroring mirroringType;
-	virtual void loadROM(std::ifstream& rom) = 0;
+
+	//PRG and CHR ROM are read in place, holding the image keeps it mapped for as long as the mapper points into it
+	std::shared_ptr<const RomImage> image;
+
+	//size is a multiple of the slot size, the bank is mapped at address and the slots after it
+	void mapPRG(uint16_t address, const uint8_t* bank, uint16_t size);
+	void mapCHR(uint16_t address, const uint8_t* bank, uint16_t size);
+	void mapPRGRAM(uint8_t* bank); //nullptr unmaps it, reads and writes at $6000-$7FFF then fault again
+
+private:
+	const uint8_t* prgSlots[4] = {};
+	const uint8_t* chrSlots[8] = {};
+	uint8_t* prgRAM = nullptr;
+
+	//CPU page tables, kept in step with prgSlots and prgRAM so the CPU doesn't need to go through the mapper for $6000-$FFFF
+	const uint8_t** cpuPages = nullptr;
+	uint8_t** cpuWritePages = nullptr;
+
+	//Bumped on every CHR bank switch so the PPU knows its decoded tiles are stale
+	uint32_t chrBankGeneration = 0;
 };
 
-#endif
\ No newline at end of file
+inline uint8_t Cartridge::readPRG(uint16_t address) const
+{
+	if(address < 0x8000)
+	{
+		if(address >= 0x6000 && prgRAM)
+			return prgRAM[address & 0x1FFF];
+		throw IllegalROMRead("Attempted to read PRG ROM", address);
+	}
+
+	return prgSlots[(address >> 13) & 0x03][address & 0x1FFF];
+}
+
+inline void Cartridge::attachMemoryMap(const uint8_t** readPages, uint8_t** writePages)
+{
+	cpuPages = readPages;
+	cpuWritePages = writePages;
+	mapPRGRAM(prgRAM);
+	for(int page = 0x80; page < 0x100; ++page)
+		cpuPages[page] = prgSlots[(page >> 5) & 0x03] + ((page & 0x1F) << 8);
+}
+
+inline void Cartridge::mapPRG(uint16_t address, const uint8_t* bank, uint16_t size)
+{
+	for(uint32_t offset = 0x0000; offset < size; offset += 0x2000)
+		prgSlots[((address + offset) >> 13) & 0x03] = bank + offset;
+
+	if(!cpuPages)
+		return;
+
+	for(uint32_t offset = 0x0000; offset < size; offset += 0x100)
+		cpuPages[(address + offset) >> 8] = bank + offset;
+}
+
+inline void Cartridge::mapCHR(uint16_t address, const uint8_t* bank, uint16_t size)
+{
+	for(uint32_t offset = 0x0000; offset < size; offset += 0x0400)
+		chrSlots[((address + offset) >> 10) & 0x07] = bank + offset;
+	++chrBankGeneration;
+}
+
+inline void Cartridge::mapPRGRAM(uint8_t* bank)
+{
+	prgRAM = bank;
+	if(!cpuPages)
+		return;
+
+	for(int page = 0x60; page < 0x80; ++page)
+		cpuPages[page] = cpuWritePages[page] = bank ? bank + ((page & 0x1F) << 8) : nullptr;
+}
+
+#endif
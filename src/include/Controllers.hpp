@@ -2,7 +2,7 @@
 #define CONTROLLERS_H
 
 #include <cstdint>
-#include <SDL2/SDL.h>
+#include "SaveState.hpp"
 
 class Controllers
 {
@@ -10,12 +10,14 @@ public:
     Controllers();
     uint8_t read(uint16_t address);
     void write(uint8_t data);
-    void getKeyPresses();
+    void setButtons(int controller, uint8_t state);
+    void serialize(SaveState& state);
     ~Controllers();
 private:
     bool S = false; //Strobe
     uint8_t JOY1 = 0x00;
     uint8_t JOY2 = 0x00;
+    uint8_t buttons[2] = {0x00, 0x00}; //Latest state from the frontend
 };
 
 #endif
\ No newline at end of file
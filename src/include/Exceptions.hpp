@@ -73,4 +73,50 @@ public:
 	}
 };
 
+class TraceFileError : virtual public std::exception
+{
+private:
+	std::string errorMessage;
+public:
+	explicit TraceFileError(std::string traceMessage, std::string path)
+	{
+		std::stringstream ss;
+		ss << traceMessage << ": " << path << std::endl;
+		errorMessage = ss.str();
+	}
+	virtual const char* what() const throw()
+	{
+		return errorMessage.c_str();
+	}
+};
+
+class ROMFileError : virtual public std::exception
+{
+private:
+	std::string errorMessage;
+public:
+	explicit ROMFileError(std::string romMessage, std::string path)
+	{
+		std::stringstream ss;
+		ss << romMessage << ": " << path << std::endl;
+		errorMessage = ss.str();
+	}
+	virtual const char* what() const throw()
+	{
+		return errorMessage.c_str();
+	}
+};
+
+class InvalidSaveState : virtual public std::exception
+{
+private:
+	std::string errorMessage;
+public:
+	explicit InvalidSaveState(std::string message) : errorMessage(message) {}
+	virtual const char* what() const throw()
+	{
+		return errorMessage.c_str();
+	}
+};
+
 #endif
\ No newline at end of file
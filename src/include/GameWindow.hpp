@@ -2,26 +2,69 @@
 #define GAMEWINDOW_H
 
 #include <SDL2/SDL.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include "NES.hpp"
+#include "AudioRing.hpp"
+#include "Rewind.hpp"
+#include "SaveState.hpp"
+#include "TripleBuffer.hpp"
+#include "Palette.hpp"
 
 const int SCREEN_WIDTH = 256;
 const int SCREEN_HEIGHT = 240;
-const int channels = 3;
+const int SCREEN_SCALE = 3; //Starting window size, resizing keeps the picture at whole multiples
 const int SCREEN_FPS = 60;
 const int SCREEN_TICKS_PER_FRAME = 1000 / SCREEN_FPS;
 
 class GameWindow
 {
 public:
-    GameWindow();
+    GameWindow(int runAheadFrames = 0);
     void run();
-    void update();
+    bool update();
     ~GameWindow();
 private:
     NES* nes;
+    Rewind rewind;
+    SaveState rewindState;
+    int runAheadFrames;
+    int lateFrames = 0, measuredFrames = 0;
+    void reportLag(std::chrono::steady_clock::duration frameTime);
+
+    //The NES only lives on the emulation thread. Finished frames come back through the triple buffer as palette indices
+    //followed by the scanline emphasis bits, the keyboard goes the other way as one atomic snapshot
+    static const uint16_t rewindHeld = 0x100;
+    static const int frameSize = SCREEN_WIDTH * SCREEN_HEIGHT + SCREEN_HEIGHT;
+    TripleBuffer frames;
+    std::atomic<uint16_t> input;
+    std::atomic<bool> quit;
+    std::thread emulation;
+    void emulate();
+    uint16_t pollKeyboard();
+    //Presentation, frames are converted straight into a streaming texture in whichever format the renderer prefers
     SDL_Window* window = nullptr;
-    SDL_Surface* screenSurface = nullptr;
-    char* frameBuffer;
+    SDL_Renderer* renderer = nullptr;
+    SDL_Texture* texture = nullptr;
+    PixelFormat textureFormat = BGRA32;
+    Palette palette;
+    void createTexture();
+
+    //Audio, the emulation thread fills the ring after every frame and SDL's callback drains it. When a device is open the
+    //ring's fill level paces emulation and nudges the APU's sample rate so it neither runs dry nor keeps growing
+    static const int audioSampleRate = 48000;
+    static const size_t audioCapacity = 16384;
+    static constexpr double maxRateAdjust = 0.005;
+    AudioRing audio;
+    SDL_AudioDeviceID audioDevice = 0;
+    int sampleRate = audioSampleRate;
+    size_t audioTarget = 0; //Samples the ring is kept at, the device's own buffer plus two frames
+    int16_t lastSample = 0; //Callback side only, repeated when the ring runs dry
+    void openAudio();
+    void queueAudio();
+    void waitForAudio();
+    static void audioCallback(void* userdata, Uint8* stream, int length);
 };
 
 #endif
\ No newline at end of file
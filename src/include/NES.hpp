@@ -1,19 +1,38 @@
 #ifndef NES_HPP
 #define NES_HPP
 #include <cstdint>
-#include <fstream>
+#include <memory>
 #include "CPU.hpp"
 #include "APU.hpp"
 #include "PPU.hpp"
 #include "Types.hpp"
 #include "Cartridge.hpp"
 #include "Exceptions.hpp"
+#include "Scheduler.hpp"
+#include "Palette.hpp"
+#include "RomImage.hpp"
+#include "SaveState.hpp"
 
 class NES
 {
 public:
-	NES(const char* file, char* frameBuffer);
+	NES(const char* file);
+	NES(std::shared_ptr<const RomImage> rom); //For sharing one image between instances, see RomCache
 	void prepareFrame();
+	void renderFrame(PixelFormat format, void* pixels, int pitch) const;
+	void copyFrame(uint8_t* indices, uint8_t* emphasis) const; //Raw palette indices (256x240) and per scanline emphasis (240)
+	size_t readSamples(int16_t* out, size_t count); //Mono 16 bit audio, prepareFrame() adds about a frame's worth
+	size_t samplesAvailable() const;
+	void setSampleRate(int rate);
+	void adjustSampleRate(double ratio); //Makes ratio times as many samples per emulated second from the next frame on, for rate control
+	void setExecutionMode(ExecutionMode mode);
+	void setButtons(int controller, uint8_t buttons);
+	uint64_t elapsedCycles() const;
+	void setTrace(Trace* trace);
+	void setProgramCounter(uint16_t address);
+	void saveState(SaveState& state);
+	void loadState(SaveState& state);
+	void setRunAhead(int frames);
 	~NES();
 
 private:
@@ -23,15 +42,26 @@ private:
 	APU* apu;
 	PPU* ppu;
 	Controllers* controllers;
-	RGB* colors;
+	Scheduler* scheduler;
 	bool frameReady = false;
+	ExecutionMode executionMode = cycleStepped;
+
+	//Save states
+	size_t stateSize = 0;
+	void serialize(SaveState& state);
+
+	//Run ahead
+	int runAheadFrames = 0;
+	SaveState runAheadState;
+	void runFrame();
 
 	//ROM Loading
-	void loadROM(const char* file);
-	void decodeHeader(std::ifstream& rom);
+	void loadROM(std::shared_ptr<const RomImage> rom);
 
-	//Palette
-	void createPalette();
+	//Video, the PPU writes palette indices and renderFrame() converts them on demand
+	uint8_t frameBuffer[256 * 240] = {};
+	uint8_t emphasis[240] = {};
+	Palette palette;
 };
 
 #endif
\ No newline at end of file
@@ -3,16 +3,24 @@
 
 #include <cstdint>
 #include "Cartridge.hpp"
+#include "Scheduler.hpp"
+#include "TileCache.hpp"
+#include "SaveState.hpp"
 #include "Types.hpp"
 
 class PPU
 {
 public:
-    PPU(Cartridge* cartridge, RGB* color, char* fb, bool& frameReady);
+    PPU(Cartridge* cartridge, Scheduler& scheduler, uint8_t* fb, uint8_t* emphasis, bool& frameReady);
     uint8_t readMemMappedReg(uint16_t address);
     void writeMemMappedReg(uint16_t address, uint8_t data);
     void tick();
+    void catchUp(uint64_t targetClock);
     bool NMI();
+    int currentScanline() const { return scanline; }
+    int currentDot() const { return dot; }
+    void serialize(SaveState& state);
+    void setOutputEnabled(bool enabled);
     ~PPU();
 private:
     struct PPU_Registers
@@ -35,19 +43,27 @@ private:
     uint8_t paletteRAM[0x20];
 
     Cartridge& cart;
-    RGB* colors;
-    char* frameBuffer;
+    TileCache tileCache;
+    Scheduler& scheduler;
+    uint8_t* frameBuffer; //Palette indices, converted to colors by whoever displays the frame
+    uint8_t* emphasis;    //PPUMASK emphasis bits for each scanline
     bool& frameReady;
 
     bool vblank = true, nmi = false;
     int scanline = 0, dot = 30;
     bool oddFrame = false;
 
+    //Dots elapsed since power up
+    uint64_t clock = 0;
+    void scheduleVBlank();
+
     uint8_t read(uint16_t address);
     void write(uint16_t address, uint8_t data);
 
     void prerenderScanline();
     void visibleScanline();
+    void renderScanline();
+    void skipScanline();
 
     bool renderingEnabled();
     void disabledRenderingDisplay();
@@ -60,19 +76,29 @@ private:
     void setHoriV();
     void setVertV();
     void incDot();
+    void nextScanline();
 
     //Sprites
-    bool checkSprite0Hit = false;
-    uint16_t spritePixel = 0x0000;
-    bool BG_Priority = true;
-    void getSpritePixel();
-
-    int N, M, OAM_Location, /*spriteCount,*/ spriteFetchCycle;
-    //uint8_t OAM_Buffer;
-    uint16_t Sprite_Pixel = 0x0000;
+    //The front sprite pixel for each x on the current line: palette nibble in the low four bits, then the flags below.
+    //Secondary OAM isn't touched while the line is drawn so this is rebuilt from it at the start of every line
+    static const uint8_t spriteBehind = 0x20, spriteZero = 0x40;
+    uint8_t spriteLine[256] = {};
+    void composeSpriteLine();
+
+    int OAM_Location = 0, spriteFetchCycle = 0;
     void spriteEval();
-    void spriteOverflowEval(int N);
+    bool spriteOverflowEval(int line, int N);
+
+    //Evaluation results for every scanline, OAM indices in the order secondary OAM would take them. OAM normally only
+    //changes once a frame through DMA so this is rebuilt when OAM or the sprite height changes instead of every line
+    uint8_t lineSprites[240][8];
+    uint8_t lineSpriteCount[240];
+    bool lineSpriteOverflow[240];
+    bool spriteLinesDirty = true, spriteLinesTall = false;
+    void buildSpriteLines();
     void spriteFetch();
+    void spritePatternAddress();
+    void fetchSpritePattern();
     void sprite0Hit();
 
     //Background
@@ -86,12 +112,15 @@ private:
     uint8_t AT_Shifter_High = 0x00, AT_Shifter_Low = 0x00;
     bool AT_Latch_High = false, AT_Latch_Low = false;
     void backgroundFetch();
+    uint64_t fetchTile();
+    void shiftTile();
     void shiftRegisters();
     void loadShiftRegisters();
     void setAttributeLatches();
 
     //Rendering
     int frameBufferPointer = 0;
+    bool outputEnabled = true; //Off for frames nobody will see, only sprite 0 hit is still worked out
     uint8_t pixelMultiplexer();
     void renderPixel();
 };
@@ -0,0 +1,30 @@
+#ifndef PALETTE_HPP
+#define PALETTE_HPP
+
+#include <cstdint>
+#include "Types.hpp"
+
+//Turns the PPU's palette index frames into something a display can use. Done once per frame by whoever wants the picture
+class Palette
+{
+public:
+	Palette();
+	RGB color(uint8_t index, uint8_t emphasis = 0) const;
+
+	//indices is one byte per pixel, emphasis one entry per scanline (PPUMASK bits 5-7). pitch is in bytes
+	void convert(const uint8_t* indices, const uint8_t* emphasis, PixelFormat format, void* pixels, int pitch) const;
+	~Palette();
+
+private:
+	//64 colors for each of the 8 emphasis combinations, packed for each output format
+	RGB colors[8][64];
+	uint32_t packed32[8][64];   //R, G, B, A in memory order
+	uint32_t packedBGRA[8][64]; //B, G, R, A in memory order, what most GPUs want
+	uint32_t packed565[8][64];
+
+	void convertScalar(const uint8_t* indices, const uint8_t* emphasis, PixelFormat format, uint8_t* pixels, int pitch) const;
+	void convertAVX2(const uint8_t* indices, const uint8_t* emphasis, PixelFormat format, uint8_t* pixels, int pitch) const;
+	static bool hasAVX2();
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef REWIND_HPP
+#define REWIND_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "SaveState.hpp"
+
+//History of save states, one per frame, kept in a fixed amount of memory. Every keyframeInterval frames a full state is stored,
+//the frames in between are stored as the XOR against that keyframe with the unchanged (zero) runs squeezed out. Most of the
+//machine doesn't change from frame to frame, so a delta is usually a few hundred bytes.
+//When the ring is full the oldest keyframe is dropped together with the deltas that depend on it
+class Rewind
+{
+public:
+	Rewind(size_t capacity = 8 << 20, int keyframeInterval = 60);
+	void push(const SaveState& state);
+	bool pop(SaveState& state); //Most recent state first, false once the history is used up
+	size_t frames() const { return entries.size(); }
+	size_t bytesUsed() const;
+	void clear();
+	~Rewind();
+
+private:
+	struct Entry
+	{
+		size_t offset;      //Position of the encoded bytes in the ring
+		size_t size;
+		uint64_t sequence;
+		uint64_t keyframe;  //Sequence number of the keyframe this entry is a delta of, its own for keyframes
+	};
+
+	std::vector<uint8_t> ring;
+	std::deque<Entry> entries;
+	size_t head = 0;
+	uint64_t nextSequence = 0;
+	int keyframeInterval;
+
+	//Decoded copy of the keyframe the newest entries refer to, and scratch space for encoding
+	std::vector<uint8_t> keyframeState;
+	uint64_t keyframeSequence = UINT64_MAX;
+	std::vector<uint8_t> scratch;
+	std::vector<uint8_t> zeros;
+
+	const Entry* findEntry(uint64_t sequence) const;
+	void loadKeyframe(uint64_t sequence);
+	size_t allocate(size_t size);
+	void dropOldest();
+
+	static size_t encode(const uint8_t* state, const uint8_t* base, size_t size, uint8_t* out);
+	static void decode(const uint8_t* in, size_t inSize, const uint8_t* base, size_t size, uint8_t* out);
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef ROMCACHE_HPP
+#define ROMCACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "RomImage.hpp"
+
+//Hands out one shared, read-only RomImage per distinct ROM so that many NES instances running the same game keep a single
+//copy of its PRG and CHR. A path seen before with the same size and modification time is answered without touching the
+//file; otherwise the ROM is mapped and matched by a hash of its contents, so the same ROM under two paths is still loaded
+//once. The cache only holds weak references, an image is freed once its last NES lets go of it. Anything writable
+//(CHR RAM, PRG RAM) stays in the mapper. Safe to use from several threads
+class RomCache
+{
+public:
+	RomCache();
+	std::shared_ptr<const RomImage> load(const char* path);
+	size_t size() const; //Images still in use
+	void clear(); //Images already handed out stay alive with their users
+	~RomCache();
+
+private:
+	struct PathEntry
+	{
+		long long size;
+		long long modified;
+		std::weak_ptr<const RomImage> image;
+	};
+
+	mutable std::mutex lock;
+	std::unordered_map<std::string, PathEntry> paths;
+	std::unordered_map<uint64_t, std::vector<std::weak_ptr<const RomImage>>> images; //Same-hash images are told apart by contents
+	void prune();
+	static uint64_t contentHash(const RomImage& image);
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef ROMIMAGE_HPP
+#define ROMIMAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Types.hpp"
+
+//An iNES file held in memory in one piece. Where the platform allows it the file is mapped rather than read, so opening a
+//ROM is a handful of system calls whatever its size and pages are only brought in when touched; otherwise it's one bulk
+//read. Mappers point straight into PRG() and CHR() instead of copying, so the image has to outlive them
+class RomImage
+{
+public:
+	RomImage(const char* path);
+	RomImage(const RomImage&) = delete;
+	RomImage& operator=(const RomImage&) = delete;
+	const HeaderData& header() const { return headerData; }
+	int mapperNumber() const { return (headerData.Flags7 & 0xF0) | (headerData.Flags6 >> 4); }
+	const uint8_t* PRG() const { return bytes + prgOffset; }
+	size_t PRGSize() const { return headerData.PRG_ROM_SIZE * 0x4000; }
+	const uint8_t* CHR() const { return bytes + prgOffset + PRGSize(); } //Only valid when CHRSize() isn't 0
+	size_t CHRSize() const { return headerData.CHR_ROM_SIZE * 0x2000; }
+	const uint8_t* data() const { return bytes; }
+	size_t size() const { return length; }
+	~RomImage();
+
+private:
+	const uint8_t* bytes = nullptr;
+	size_t length = 0;
+	bool mapped = false;
+	std::vector<uint8_t> buffer; //Holds the file when it couldn't be mapped
+
+	HeaderData headerData;
+	size_t prgOffset = 16;
+	void readFile(const char* path);
+	void decodeHeader(const char* path);
+	void unmap();
+};
+
+#endif
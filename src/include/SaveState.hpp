@@ -0,0 +1,58 @@
+#ifndef SAVESTATE_HPP
+#define SAVESTATE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+//Flat snapshot of the whole machine. Every component has one serialize() that both saves and loads by passing its members
+//through field() and block(), so the two directions can't drift apart. The buffer is sized by a measuring pass the first time
+//and reused after that, saving and loading are just memcpys.
+//
+//Layout: "NESS", format version, payload size, payload. Bump version whenever a serialize() changes what it writes
+class SaveState
+{
+public:
+	enum Mode {measuring, saving, loading};
+	static const uint32_t version = 4;
+	static const size_t headerSize = 12;
+
+	SaveState();
+	void beginMeasure();
+	void beginSave(size_t payloadSize);
+	void beginLoad(size_t payloadSize);
+	void finish();
+
+	template<typename T> void field(T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be copied into a save state");
+		block(&value, sizeof(T));
+	}
+	void block(void* data, size_t size)
+	{
+		if(mode == saving)
+			std::memcpy(buffer.data() + position, data, size);
+		else if(mode == loading)
+			std::memcpy(data, buffer.data() + position, size);
+		position += size;
+	}
+
+	bool isLoading() const { return mode == loading; }
+	size_t payloadSize() const { return position - headerSize; }
+
+	//The serialized bytes, header included
+	uint8_t* data() { return buffer.data(); }
+	const uint8_t* data() const { return buffer.data(); }
+	size_t size() const { return buffer.size(); }
+	void assign(const uint8_t* bytes, size_t size);
+	~SaveState();
+
+private:
+	std::vector<uint8_t> buffer;
+	size_t position = 0;
+	Mode mode = measuring;
+};
+
+#endif
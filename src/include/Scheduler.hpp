@@ -0,0 +1,33 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <cstdint>
+#include <functional>
+#include "SaveState.hpp"
+
+//Timestamps are on the master clock, counted in PPU dots (three per CPU cycle)
+enum ScheduledEvent {vblankStart, nmiRaised, dmaEnd, apuFrameIRQ, mapperIRQ, eventCount};
+
+class Scheduler
+{
+public:
+	Scheduler();
+	void setHandler(ScheduledEvent event, std::function<void(uint64_t now)> handler);
+	void schedule(ScheduledEvent event, uint64_t timestamp);
+	void cancel(ScheduledEvent event);
+	uint64_t nextTimestamp() const { return next; }
+	void dispatch(uint64_t now);
+	void serialize(SaveState& state);
+	~Scheduler();
+
+private:
+	static const uint64_t never = UINT64_MAX;
+	uint64_t timestamps[eventCount];
+	std::function<void(uint64_t now)> handlers[eventCount];
+
+	uint64_t next = never;
+	ScheduledEvent nextEvent = vblankStart;
+	void findNext();
+};
+
+#endif
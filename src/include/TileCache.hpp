@@ -0,0 +1,44 @@
+#ifndef TILECACHE_HPP
+#define TILECACHE_HPP
+
+#include <array>
+#include <cstdint>
+#include "Cartridge.hpp"
+
+//Pattern table rows decoded to one 2 bit pixel per byte, pixel 0 (leftmost on screen) in the lowest byte
+class TileCache
+{
+public:
+	struct Row
+	{
+		uint64_t pixels;
+		uint64_t flipped; //Mirrored horizontally for sprites
+		uint8_t low, high;
+	};
+
+	TileCache(Cartridge& cartridge);
+	const Row& row(uint16_t address);
+	void invalidate(uint16_t address);
+	void clear();
+	static uint64_t decode(uint8_t low, uint8_t high);
+	static uint64_t decodeFlipped(uint8_t low, uint8_t high);
+	~TileCache();
+
+private:
+	//512 tiles of 8 rows, the bitplane bit of the address is dropped
+	static const int rowCount = 0x1000;
+	static int index(uint16_t address) { return ((address >> 1) & 0x0FF8) | (address & 0x0007); }
+
+	Cartridge& cart;
+	Row rows[rowCount];
+	uint32_t stamps[rowCount];
+	uint32_t generation = 1;
+	uint32_t chrGeneration;
+
+	//Spreads the 8 bits of a bitplane into the low bit of 8 bytes
+	static const std::array<uint64_t, 256> spread;
+	static const std::array<uint64_t, 256> spreadFlipped;
+	static constexpr std::array<uint64_t, 256> buildSpread(bool flipped);
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//CPU state at the start of an instruction, after its opcode has been fetched
+struct TraceEntry
+{
+	uint16_t PC;
+	uint8_t opcode;
+	uint8_t A, X, Y, P, SP;
+	int16_t scanline;
+	uint16_t dot;
+	uint32_t cycle; //Low 32 bits of the CPU cycle count
+};
+
+static_assert(sizeof(TraceEntry) == 16, "TraceEntry is written to trace files as is");
+
+//Ring buffer of the most recent instructions. Recording is a single store, formatting is left to whoever reads the trace.
+//Trace files are a "NTRC" tag, a version, the entry count and then the entries in host byte order, oldest first
+class Trace
+{
+public:
+	Trace(size_t capacity = 1 << 16);
+	void record(const TraceEntry& entry) { entries[recorded++ & mask] = entry; }
+	size_t size() const { return recorded < entries.size() ? recorded : entries.size(); }
+	uint64_t total() const { return recorded; }
+	const TraceEntry& operator[](size_t i) const; //0 is the oldest entry still held
+	void clear();
+	void save(const char* path) const;
+	void load(const char* path);
+	~Trace();
+
+private:
+	static const uint32_t fileVersion = 1;
+	std::vector<TraceEntry> entries;
+	uint64_t mask;
+	uint64_t recorded = 0;
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef TRIPLEBUFFER_HPP
+#define TRIPLEBUFFER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Hands whole frames from one producer thread to one consumer thread without locks. The producer always has a buffer to
+//write, the consumer always has the last complete frame, and the third buffer is swapped between them with a single atomic
+//exchange. A producer that runs ahead overwrites frames the consumer never picked up instead of waiting for it
+class TripleBuffer
+{
+public:
+	TripleBuffer(size_t frameSize);
+	uint8_t* back() { return buffers[backIndex].data(); } //Producer side, where the next frame is written
+	void publish();                                       //Producer side, the back buffer becomes the newest frame
+	bool acquire();                                       //Consumer side, false when nothing was published since the last call
+	const uint8_t* front() const { return buffers[frontIndex].data(); }
+	~TripleBuffer();
+
+private:
+	static const uint8_t fresh = 0x04; //Set in middle when it holds a frame the consumer hasn't seen
+	std::vector<uint8_t> buffers[3];
+	std::atomic<uint8_t> middle;
+	uint8_t backIndex = 0, frontIndex = 2;
+};
+
+#endif
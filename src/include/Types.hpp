@@ -11,7 +11,11 @@
 
 #define uint unsigned int //Mingw doesn't recognize uintg
 
-enum Mirroring = {horizontal, vertical, single, quad};
+enum Mirroring {horizontal, vertical, single, quad};
+
+enum ExecutionMode {cycleStepped, instructionStepped};
+
+enum PixelFormat {RGB24, RGBA32, RGB565, BGRA32};
 
 struct RGB
 {
@@ -35,7 +39,7 @@ struct Sprite
 	uint8_t tile;
 	uint8_t attributes;
 	int X;
-	uint8_t PT_High, PT_Low;
+	uint64_t pattern; //Decoded pixels in screen order, see TileCache
 
 	int offset;
 	bool sprite0;
@@ -43,36 +47,10 @@ struct Sprite
 	void clear()
 	{
 		Y = tile = attributes = X = 0xFF;
-		PT_High = PT_Low = 0x00;
+		pattern = 0;
 		offset = 0;
 		sprite0 = false;
 	}
-
-	bool decrementX()
-	{
-		--X;
-		return (X <= -1 && X >= -8);	
-	}
-
-	uint8_t getPixelNibble()
-	{
-		uint8_t pixelNibble = 0x00 | ((attributes & 0x03) << 2);
-		if(attributes & 0x40) //Flip horizontally
-		{
-			pixelNibble |= ((PT_High & 0x01) << 1);
-			PT_High >>= 1;
-			pixelNibble |= (PT_Low & 0x01);
-			PT_Low >>= 1;
-		}
-		else
-		{
-			pixelNibble |= ((PT_High & 0x80) >> 6);
-			PT_High <<= 1;
-			pixelNibble |= ((PT_Low & 0x80) >> 7);
-			PT_Low <<= 1;
-		}	
-		return pixelNibble;	
-	}
 };
 
 struct HeaderData
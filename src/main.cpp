@@ -1,11 +1,19 @@
 #include "include/GameWindow.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
 
 int main(int argc, char* argv[])
 {
-	(void)argc;
-	(void)argv;
+	//--run-ahead N hides N frames of input lag by showing the frame N frames ahead of the real one
+	int runAheadFrames = 0;
+	for(int i = 1; i < argc; ++i)
+	{
+		if(std::string(argv[i]) == "--run-ahead" && i + 1 < argc)
+			runAheadFrames = std::max(0, std::atoi(argv[++i]));
+	}
 
-	GameWindow window;
+	GameWindow window(runAheadFrames);
 	window.run();
 	
 	return 0;
@@ -1,37 +1,52 @@
 #include "MMC1.hpp"
 
-MMC1::MMC1(HeaderData& header, std::ifstream& rom)
+MMC1::MMC1(std::shared_ptr<const RomImage> rom)
 {
-    mirroringIsVertical = header.Flags6 & 0x01;
-    PRG_Bank_Count = header.PRG_ROM_SIZE;
-    CHR_Bank_Count = header.CHR_ROM_SIZE;
-    PRG_Banks.resize(PRG_Bank_Count);
-    loadROM(rom);
-}
+    image = rom;
+    mirroringType = (rom->header().Flags6 & 0x01) ? vertical : horizontal;
+    PRG_Bank_Count = rom->header().PRG_ROM_SIZE;
+    CHR_Bank_Count = rom->header().CHR_ROM_SIZE;
 
-uint8_t MMC1::readPRG(uint16_t address)
-{
-    if(address < 0x8000)
-        throw IllegalROMRead("Attempted to read PRG ROM", address);
+    for(int i = 0; i < PRG_Bank_Count; ++i)
+        PRG_Banks.push_back(rom->PRG() + i * 0x4000);
+    PRG_Bank_2 = PRG_Bank_Count - 1;
 
-    address -= 0x8000;
+    //INES gives bank count as multiple of 8KB, but each mmc1 bank is half that
+    const uint8_t* CHR = rom->CHR();
+    if(CHR_Bank_Count == 0)
+    {
+        CHR_RAM.resize(0x2000);
+        CHR = CHR_RAM.data();
+        CHR_Bank_Count = 1;
+    }
+    for(int i = 0; i < CHR_Bank_Count * 2; ++i)
+        CHR_Banks.push_back(CHR + i * 0x1000);
 
-    if(address < 0x4000) //First bank
-        return PRG_Banks[PRG_Bank_1][address];
-    else //Second bank
-        return PRG_Banks[PRG_Bank_2][address - 0x4000];
+    //One 8KB bank of PRG RAM at $6000-$7FFF, per instance like the CHR RAM
+    RAM_Banks.resize(1, std::vector<uint8_t>(0x2000, 0x00));
+
+    mapBanks();
 }
 
 void MMC1::writePRG(uint16_t address, uint8_t data)
 {
     if(address < 0x8000)
-        throw IllegalROMWrite("Attempted to write PRG ROM", address);
+    {
+        //The CPU writes PRG RAM through its page table, this is only reached by other callers
+        if(address >= 0x6000 && containsRAM)
+        {
+            RAM_Banks[RAM_Bank][address & 0x1FFF] = data;
+            return;
+        }
+        throw IllegalROMWrite("Attempted to write PRG ROM", address, data);
+    }
 
     if(data & 0x80)
     {
         PRG_Bank_2 = PRG_Bank_Count - 1;    //Fix 0xC000 - 0xFFFF to last PRG bank
         shiftRegister = 0x00;               //Reset register
         writeCounter = 0;                   //Prepare for first of 5 writes
+        mapBanks();
     }
     else
     {
@@ -43,17 +58,17 @@ void MMC1::writePRG(uint16_t address, uint8_t data)
 
             if(address < 0xA000) //Control Register
             {
-
+                mapBanks();
             }
             else if(address < 0xC000) //CHR Bank 0
             {
-
+                mapBanks();
             }
             else if(address < 0xE000) //CHR Bank 1
             {
-
+                mapBanks();
             }
-            else() //PRG Bank
+            else //PRG Bank
             {
 
             }
@@ -63,48 +78,41 @@ void MMC1::writePRG(uint16_t address, uint8_t data)
     }
 }
 
-uint8_t MMC1::readCHR(uint16_t address)
+void MMC1::mapBanks()
 {
-    if(address > 0x1FFF)
-        throw IllegalROMRead("Attempted to read CHR ROM", address);
-
-    if(address < 0x1000) //First bank
-        return CHR_Banks[CHR_Bank_2][address];
-    else //Second bank
-        return CHR_Banks[CHR_Bank_2][address - 0x1000];
+    mapPRG(0x8000, PRG_Banks[PRG_Bank_1], 0x4000);
+    mapPRG(0xC000, PRG_Banks[PRG_Bank_2], 0x4000);
+    mapCHR(0x0000, CHR_Banks[CHR_Bank_1], 0x1000);
+    mapCHR(0x1000, CHR_Banks[CHR_Bank_2], 0x1000);
+    mapPRGRAM(containsRAM ? RAM_Banks[RAM_Bank].data() : nullptr);
 }
 
-void MMC1::writeCHR(uint16_t address, uint8_t data)
+void MMC1::serialize(SaveState& state)
 {
-
-}
-
-mirroringType MMC1::verticalMirroring() const
-{
-    return mirroringType;
+    state.field(writeCounter);
+    state.field(shiftRegister);
+    state.field(PRG_Bank_1);
+    state.field(PRG_Bank_2);
+    state.field(CHR_Bank_1);
+    state.field(CHR_Bank_2);
+    state.field(RAM_Bank);
+    for(std::vector<uint8_t>& bank : RAM_Banks)
+        state.block(bank.data(), bank.size());
+    if(!CHR_RAM.empty())
+        state.block(CHR_RAM.data(), CHR_RAM.size());
+
+    if(state.isLoading())
+        mapBanks();
 }
 
-void MMC1::loadROM(std::ifstream& rom)
+void MMC1::writeCHR(uint16_t address, uint8_t data)
 {
-    for(int i = 0; i < PRG_Bank_Count; ++i)
-    {
-        PRG_Banks[i].resize(0x4000); //Each bank is 16KB
-        for(uint16_t j = 0x0000; j < 0x4000; ++j)
-        {
-            rom >> std::noskipws >> std::hex >> PRG_Banks[i][j];
-        }
-    }
-
-    PRG_Bank_2 = PRG_Bank_Count - 1;
+    //Only boards without CHR ROM have anything to write to, through whichever 4KB bank is mapped there
+    if(CHR_RAM.empty())
+        return;
 
-    for(int i = 0; i < CHR_Bank_Count * 2; ++i) //INES gives bank count as multiple of 8KB, but each mmc1 bank is half that
-    {
-        CHR_Banks[i].resize(0x1000); //Each bank is 4KB
-        for(uint16_t j = 0x0000; j < 0x1000; ++j)
-        {
-            rom >> std::noskipws >> std::hex >> CHR_Banks[i][j];
-        }
-    }
+    int bank = (address & 0x1000) ? CHR_Bank_2 : CHR_Bank_1;
+    CHR_RAM[(bank * 0x1000 + (address & 0x0FFF)) % CHR_RAM.size()] = data;
 }
 
 MMC1::~MMC1()
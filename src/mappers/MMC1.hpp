@@ -9,24 +9,23 @@
 class MMC1 : public Cartridge
 {
 public:
-    MMC1(HeaderData& header, std::ifstream& rom);
-    uint8_t readPRG(uint16_t address);
+    MMC1(std::shared_ptr<const RomImage> rom);
     void writePRG(uint16_t address, uint8_t data);
-    uint8_t readCHR(uint16_t address);
     void writeCHR(uint16_t address, uint8_t data);
-    bool verticalMirroring() const;
+    void serialize(SaveState& state);
     ~MMC1();
 private:
-    void loadROM(std::ifstream& rom);
-    bool containsRAM;
+    void mapBanks();
+    bool containsRAM = true;
     int writeCounter = 0;
     int PRG_Bank_Count, CHR_Bank_Count;
     int PRG_Bank_1 = 0, PRG_Bank_2;
-    int CHR_Bank_1, CHR_Bank_2;
-    int RAM_Bank;
+    int CHR_Bank_1 = 0, CHR_Bank_2 = 1;
+    int RAM_Bank = 0;
     uint8_t shiftRegister = 0x00;
-    std::vector<std::vector<uint8_t>> PRG_Banks; 
-    std::vector<std::vector<uint8_t>> CHR_Banks;
+    std::vector<const uint8_t*> PRG_Banks; //16KB slices of the ROM image
+    std::vector<const uint8_t*> CHR_Banks; //4KB slices, of CHR_RAM when the board has no CHR ROM
+    std::vector<uint8_t> CHR_RAM;
     std::vector<std::vector<uint8_t>> RAM_Banks;
 };
 
@@ -1,38 +1,18 @@
 #include "NROM.hpp"
 
-NROM::NROM(HeaderData& header, std::ifstream& rom)
+NROM::NROM(std::shared_ptr<const RomImage> rom)
 {
-	if(header.PRG_ROM_SIZE == 1)
-	{
-		PRG_Mirroring = true;
-		PRG_ROM = new uint8_t[0x4000];
-	}
-	else
-	{
-		PRG_Mirroring = false;
-		PRG_ROM = new uint8_t[0x8000];
-	}
-	CHR_ROM = new uint8_t[0x2000];
-
-	if(header.Flags6 & 0x01)
-		mirroringType = vertical;
-	else
-		mirroringTpye = horizontal;
+	image = rom;
 
-	loadROM(rom);
-}
-
-uint8_t NROM::readPRG(uint16_t address)
-{
-	if(address < 0x8000)
-		throw IllegalROMRead("Attempted to read PRG ROM", address);
+	//Boards with 16KB of PRG ROM see it at both $8000 and $C000
+	mapPRG(0x8000, rom->PRG(), 0x4000);
+	mapPRG(0xC000, rom->header().PRG_ROM_SIZE == 1 ? rom->PRG() : rom->PRG() + 0x4000, 0x4000);
+	mapCHR(0x0000, rom->CHRSize() ? rom->CHR() : CHR_RAM, 0x2000);
 
-	if(PRG_Mirroring)
-		address = (address % 0xC000) + ((address / 0xC000) * 0x8000) - 0x8000;
+	if(rom->header().Flags6 & 0x01)
+		mirroringType = vertical;
 	else
-		address -= 0x8000;
-
-	return PRG_ROM[address];
+		mirroringType = horizontal;
 }
 
 void NROM::writePRG(uint16_t address, uint8_t data)
@@ -41,40 +21,20 @@ void NROM::writePRG(uint16_t address, uint8_t data)
 	//throw IllegalROMWrite("Attempted to write PRG ROM", address, data);
 }
 
-uint8_t NROM::readCHR(uint16_t address)
-{
-	if(address > 0x1FFF)
-		throw IllegalROMRead("Attempted to read CHR ROM", address);
-	return CHR_ROM[address];
-}
-
 void NROM::writeCHR(uint16_t address, uint8_t data)
 {
-	(void)address; (void)data;
-	//throw IllegalROMWrite("Attempted to write CHR ROM", address, data);
+	//CHR ROM ignores writes, the PPU drops the decoded row either way
+	if(!image->CHRSize())
+		CHR_RAM[address & 0x1FFF] = data;
 }
 
-Mirroring NROM::nametableMirroring() const
+void NROM::serialize(SaveState& state)
 {
-	return mirroringType;
+	if(!image->CHRSize())
+		state.block(CHR_RAM, sizeof(CHR_RAM));
 }
 
 NROM::~NROM()
 {
-	delete[] PRG_ROM;
-	delete[] CHR_ROM;
-}
-
-void NROM::loadROM(std::ifstream& rom)
-{
-	uint16_t max = PRG_Mirroring ? 0x4000 : 0x8000;
-	for(uint16_t address = 0x0000; address < max; ++address)
-	{
-		rom >> std::noskipws >> std::hex >> PRG_ROM[address];
-	}
 
-	for(uint16_t address = 0x0000; address < 0x2000; ++address)
-	{
-		rom >> std::hex >> CHR_ROM[address];
-	}
 }
\ No newline at end of file
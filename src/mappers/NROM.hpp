@@ -7,18 +7,13 @@
 class NROM : public Cartridge
 {
 public:
-	NROM(HeaderData& header, std::ifstream& rom);
-	uint8_t readPRG(uint16_t address);
+	NROM(std::shared_ptr<const RomImage> rom);
 	void writePRG(uint16_t address, uint8_t data);
-	uint8_t readCHR(uint16_t address);
 	void writeCHR(uint16_t address, uint8_t data);
-	bool verticalMirroring() const;
+	void serialize(SaveState& state);
 	~NROM();
 private:
-	uint8_t* PRG_ROM;
-	uint8_t* CHR_ROM;
-	bool PRG_Mirroring;
-	void loadROM(std::ifstream& rom);
+	uint8_t CHR_RAM[0x2000] = {}; //Stands in for CHR ROM on boards that don't have any
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,73 @@
+//Runs a small MMC1 program that stores a byte in PRG RAM and loads it back, then checks the value the CPU saw. Also checks
+//the byte survives a save state loaded into a fresh NES. Returns nonzero on failure.
+//
+//	nes-test-prgram
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include "../src/include/NES.hpp"
+#include "../src/include/Trace.hpp"
+
+namespace
+{
+	const char* romPath = "nes-test-prgram.nes";
+
+	//$C000: LDA #$08, STA $2001 (the PPU only finishes frames with rendering on)
+	//$C005: LDA #$5A, STA $6123, LDA #$00
+	//$C00C: LDA $6123, STA $0010
+	//$C012: JMP $C012
+	const uint16_t reload = 0xC00C, check = 0xC00F;
+	const uint8_t program[] = {0xA9, 0x08, 0x8D, 0x01, 0x20, 0xA9, 0x5A, 0x8D, 0x23, 0x61, 0xA9, 0x00, 0xAD, 0x23, 0x61, 0x8D, 0x10,
+	                           0x00, 0x4C, 0x12, 0xC0};
+
+	//Mapper 1, two 16KB PRG banks with the program at the start of the last one (fixed at $C000 after reset) and CHR RAM
+	void writeROM()
+	{
+		std::vector<uint8_t> rom(16 + 0x8000, 0x00);
+		const uint8_t header[16] = {'N', 'E', 'S', 0x1A, 2, 0, 0x10, 0x00};
+		std::copy(header, header + 16, rom.begin());
+		std::copy(program, program + sizeof(program), rom.begin() + 16 + 0x4000);
+		for(int vector = 0x7FFA; vector < 0x8000; vector += 2)
+		{
+			rom[16 + vector] = 0x00;
+			rom[16 + vector + 1] = 0xC0;
+		}
+		std::ofstream(romPath, std::ios::binary).write((const char*)rom.data(), rom.size());
+	}
+
+	//A as the instruction at check starts, which is what the load from PRG RAM just read
+	int loadedValue(NES& nes)
+	{
+		Trace trace;
+		nes.setTrace(&trace);
+		nes.prepareFrame();
+		nes.setTrace(nullptr);
+		for(size_t i = 0; i < trace.size(); ++i)
+		{
+			if(trace[i].PC == check)
+				return trace[i].A;
+		}
+		return -1;
+	}
+}
+
+int main()
+{
+	writeROM();
+	NES nes(romPath);
+	int value = loadedValue(nes);
+	std::printf("PRG RAM read back %02X\n", value);
+
+	SaveState state;
+	nes.saveState(state);
+	NES restored(romPath);
+	restored.loadState(state);
+	restored.setProgramCounter(reload);
+	int restoredValue = loadedValue(restored);
+	std::printf("PRG RAM after loading a save state %02X\n", restoredValue);
+
+	std::remove(romPath);
+	return value == 0x5A && restoredValue == 0x5A ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+//Pushes states whose encoded size varies from frame to frame through rings small enough to wrap many times, then pops the
+//whole history and checks every state against what was pushed. Returns nonzero on the first mismatch.
+//
+//	nes-test-rewind
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "../src/include/Rewind.hpp"
+#include "../src/include/SaveState.hpp"
+
+namespace
+{
+	const size_t stateSize = 4096;
+
+	uint32_t next(uint32_t& seed)
+	{
+		seed = seed * 1664525 + 1013904223;
+		return seed >> 8;
+	}
+
+	//Mostly zeros with a run of noise of random length, so keyframes and deltas come out anywhere from a few bytes to the
+	//whole state
+	std::vector<uint8_t> makeState(uint32_t& seed)
+	{
+		std::vector<uint8_t> state(stateSize, 0);
+		size_t start = next(seed) % stateSize;
+		size_t length = next(seed) % (stateSize - start);
+		for(size_t i = start; i < start + length; ++i)
+			state[i] = next(seed) | 1;
+		return state;
+	}
+
+	bool run(size_t capacity, int keyframeInterval, int frames)
+	{
+		Rewind rewind(capacity, keyframeInterval);
+		std::vector<std::vector<uint8_t>> pushed;
+		SaveState state;
+		uint32_t seed = capacity ^ keyframeInterval;
+
+		for(int frame = 0; frame < frames; ++frame)
+		{
+			pushed.push_back(makeState(seed));
+			state.assign(pushed.back().data(), stateSize);
+			rewind.push(state);
+		}
+
+		size_t held = rewind.frames();
+		for(size_t i = 0; i < held; ++i)
+		{
+			const std::vector<uint8_t>& expected = pushed[pushed.size() - 1 - i];
+			if(!rewind.pop(state) || state.size() != stateSize || std::memcmp(state.data(), expected.data(), stateSize) != 0)
+			{
+				std::printf("ring %zu interval %d: state %zu frames back doesn't match\n", capacity, keyframeInterval, i);
+				return false;
+			}
+		}
+
+		std::printf("ring %zu interval %d: %d pushed, %zu popped\n", capacity, keyframeInterval, frames, held);
+		return !rewind.pop(state);
+	}
+}
+
+int main()
+{
+	bool ok = true;
+	for(size_t capacity : {10000, 30000})
+	{
+		for(int keyframeInterval : {1, 4, 60})
+			ok = run(capacity, keyframeInterval, 500) && ok;
+	}
+	return ok ? 0 : 1;
+}
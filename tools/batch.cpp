@@ -0,0 +1,80 @@
+//Runs many emulation sessions at once, one NES per worker thread, and reports each session and the total throughput.
+//
+//    nes-batch <frames> <rom>... [--threads N] [--repeat N] [--instruction-stepped]
+//
+//--repeat queues every ROM N times, which is handy for checking how throughput scales with --threads
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "../src/include/BatchRunner.hpp"
+
+int main(int argc, char* argv[])
+{
+	if(argc < 3)
+	{
+		std::cerr << "Usage: " << argv[0] << " <frames> <rom>... [--threads N] [--repeat N] [--instruction-stepped]" << std::endl;
+		return 1;
+	}
+
+	long frames = std::atol(argv[1]);
+	unsigned threads = 0;
+	int repeat = 1;
+	ExecutionMode mode = cycleStepped;
+	std::vector<const char*> roms;
+
+	for(int i = 2; i < argc; ++i)
+	{
+		if(std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			threads = std::atoi(argv[++i]);
+		else if(std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+			repeat = std::max(1, std::atoi(argv[++i]));
+		else if(std::strcmp(argv[i], "--instruction-stepped") == 0)
+			mode = instructionStepped;
+		else
+			roms.push_back(argv[i]);
+	}
+
+	std::vector<BatchJob> jobs;
+	for(int r = 0; r < repeat; ++r)
+	{
+		for(const char* rom : roms)
+		{
+			BatchJob job;
+			job.romPath = rom;
+			job.frames = frames;
+			job.mode = mode;
+			jobs.push_back(job);
+		}
+	}
+
+	BatchRunner runner(threads);
+	auto start = std::chrono::steady_clock::now();
+	std::vector<BatchResult> results = runner.run(jobs);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	int failed = 0;
+	uint64_t cycles = 0;
+	for(size_t i = 0; i < results.size(); ++i)
+	{
+		const BatchResult& result = results[i];
+		if(result.ok)
+			std::printf("%s: %llu cycles, frame %016llx, %.3f s\n", jobs[i].romPath.c_str(), (unsigned long long)result.cycles,
+						(unsigned long long)result.frameHash, result.seconds);
+		else
+		{
+			std::printf("%s: failed: %s\n", jobs[i].romPath.c_str(), result.error.c_str());
+			++failed;
+		}
+		cycles += result.cycles;
+	}
+
+	std::printf("%zu sessions on %u threads in %.3f s\n", jobs.size(), runner.threadCount(), seconds);
+	std::printf("sessions/sec: %.2f  frames/sec: %.1f  cycles/sec: %.0f\n", jobs.size() / seconds,
+				(jobs.size() - failed) * frames / seconds, cycles / seconds);
+
+	return failed ? 1 : 0;
+}
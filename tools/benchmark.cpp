@@ -0,0 +1,361 @@
+//Component micro-benchmarks, printed as JSON so results can be collected and compared between builds.
+//
+//	nes-benchmark [nestest rom] [filter]
+//
+//Each case reports how many operations it ran and the average time of one. The unit of an operation is the last part of the
+//case name: a CPU cycle, a PPU frame, a mapper read or an emulated frame. Only cases whose name contains filter are run.
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../src/include/NES.hpp"
+#include "../src/mappers/NROM.hpp"
+#include "../src/mappers/MMC1.hpp"
+
+namespace
+{
+	//Runs body with a growing iteration count until one run takes long enough to time reliably
+	template<typename Body>
+	void measure(std::vector<std::string>& results, const std::string& filter, const std::string& name, Body body)
+	{
+		if(name.find(filter) == std::string::npos)
+			return;
+
+		const double minimumSeconds = 0.25;
+		uint64_t iterations = 1;
+		double seconds = 0.0;
+
+		while(true)
+		{
+			auto start = std::chrono::steady_clock::now();
+			body(iterations);
+			seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			if(seconds >= minimumSeconds)
+				break;
+			iterations *= (seconds < minimumSeconds / 10) ? 10 : 2;
+		}
+
+		std::ostringstream ss;
+		ss << std::fixed << std::setprecision(3) << "    {\"name\": \"" << name << "\", \"iterations\": " << iterations
+		   << ", \"ns_per_op\": " << seconds * 1e9 / iterations << "}";
+		results.push_back(ss.str());
+	}
+
+	//32KB of PRG with the program at $8000, reset and NMI vectors pointing at it, and 8KB of CHR RAM with noise in it
+	class BenchmarkCartridge : public Cartridge
+	{
+	public:
+		BenchmarkCartridge(const std::vector<uint8_t>& program)
+		{
+			for(int i = 0; i < 0x8000; ++i)
+				PRG[i] = 0xEA; //NOP
+			for(size_t i = 0; i < program.size(); ++i)
+				PRG[i] = program[i];
+			PRG[0x7FFA] = 0x00; PRG[0x7FFB] = 0xFF; //NMI
+			PRG[0x7FFC] = 0x00; PRG[0x7FFD] = 0x80; //Reset
+			PRG[0x7F00] = 0x40; //RTI
+
+			uint32_t seed = 0x12345678;
+			for(int i = 0; i < 0x2000; ++i)
+			{
+				seed = seed * 1103515245 + 12345;
+				CHR[i] = seed >> 24;
+			}
+			mirroringType = vertical;
+			mapPRG(0x8000, PRG, 0x8000);
+			mapCHR(0x0000, CHR, 0x2000);
+		}
+		void writePRG(uint16_t address, uint8_t data) { (void)address; (void)data; }
+		void writeCHR(uint16_t address, uint8_t data) { CHR[address & 0x1FFF] = data; }
+	private:
+		uint8_t PRG[0x8000];
+		uint8_t CHR[0x2000];
+	};
+
+	//Everything the CPU and PPU need, wired the same way NES does it
+	struct Machine
+	{
+		Machine(const std::vector<uint8_t>& program)
+		: cart(program), apu(cart, scheduler), ppu(&cart, scheduler, frameBuffer, emphasis, frameReady), cpu(&cart, ppu, apu, controllers, scheduler)
+		{
+		}
+		BenchmarkCartridge cart;
+		Scheduler scheduler;
+		APU apu;
+		Controllers controllers;
+		uint8_t frameBuffer[256 * 240];
+		uint8_t emphasis[240];
+		bool frameReady = false;
+		PPU ppu;
+		CPU cpu;
+	};
+
+	//Register and immediate arithmetic
+	const std::vector<uint8_t> aluMix =
+	{
+		0xA9, 0x01,         //LDA #$01
+		0x69, 0x03,         //ADC #$03
+		0x29, 0x7F,         //AND #$7F
+		0x09, 0x10,         //ORA #$10
+		0x49, 0x55,         //EOR #$55
+		0xC9, 0x20,         //CMP #$20
+		0x0A,               //ASL A
+		0x4A,               //LSR A
+		0x2A,               //ROL A
+		0xE9, 0x01,         //SBC #$01
+		0xE8,               //INX
+		0xC8,               //INY
+		0xAA,               //TAX
+		0x18,               //CLC
+		0x4C, 0x00, 0x80    //JMP $8000
+	};
+
+	//Loads and stores through most addressing modes, including page crossings. STA $20,X sweeps the whole zero page over
+	//time, so the value it stores has to keep the pointer at $30 inside RAM
+	const std::vector<uint8_t> memoryMix =
+	{
+		0xA9, 0xF0,         //LDA #$F0
+		0x85, 0x30,         //STA $30
+		0xA9, 0x04,         //LDA #$04
+		0x85, 0x31,         //STA $31
+		0xA0, 0x20,         //LDY #$20
+		0xA2, 0x00,         //LDX #$00
+		0xA9, 0x04,         //LDA #$04      <- $800C
+		0x85, 0x10,         //STA $10
+		0xA5, 0x10,         //LDA $10
+		0x95, 0x20,         //STA $20,X
+		0xB5, 0x20,         //LDA $20,X
+		0x8D, 0x00, 0x03,   //STA $0300
+		0xAD, 0x00, 0x03,   //LDA $0300
+		0x9D, 0x00, 0x04,   //STA $0400,X
+		0xBD, 0x00, 0x04,   //LDA $0400,X
+		0x91, 0x30,         //STA ($30),Y
+		0xB1, 0x30,         //LDA ($30),Y
+		0xE6, 0x40,         //INC $40
+		0xEE, 0x00, 0x05,   //INC $0500
+		0xE8,               //INX
+		0x4C, 0x0C, 0x80    //JMP $800C
+	};
+
+	//Tight loops, stack traffic and subroutine calls
+	const std::vector<uint8_t> branchMix =
+	{
+		0xA2, 0x10,         //LDX #$10
+		0xCA,               //DEX           <- $8002
+		0xD0, 0xFD,         //BNE $8002
+		0x48,               //PHA
+		0x68,               //PLA
+		0x20, 0x0F, 0x80,   //JSR $800F
+		0xF0, 0x00,         //BEQ $800C
+		0x4C, 0x00, 0x80,   //JMP $8000     <- $800C
+		0x60                //RTS           <- $800F
+	};
+
+	void runCPU(Machine& machine, uint64_t cycles)
+	{
+		for(uint64_t i = 0; i < cycles; ++i)
+			machine.cpu.tick();
+	}
+
+	//Fills nametable 0, the palettes and OAM with a busy but fixed picture and turns rendering on during vblank like a game would
+	const uint64_t setupClock = 242 * 341;
+	void setupPPU(PPU& ppu)
+	{
+		ppu.catchUp(setupClock);
+
+		ppu.writeMemMappedReg(0x2006, 0x20);
+		ppu.writeMemMappedReg(0x2006, 0x00);
+		for(int i = 0; i < 0x3C0; ++i)
+			ppu.writeMemMappedReg(0x2007, i * 7);
+		for(int i = 0; i < 0x40; ++i)
+			ppu.writeMemMappedReg(0x2007, i * 37);
+
+		ppu.writeMemMappedReg(0x2006, 0x3F);
+		ppu.writeMemMappedReg(0x2006, 0x00);
+		for(int i = 0; i < 0x20; ++i)
+			ppu.writeMemMappedReg(0x2007, (i * 11) & 0x3F);
+
+		//64 sprites spread over the screen, enough to overflow some lines
+		ppu.writeMemMappedReg(0x2003, 0x00);
+		for(int i = 0; i < 64; ++i)
+		{
+			ppu.writeMemMappedReg(0x2004, (i * 29) % 224); //Y
+			ppu.writeMemMappedReg(0x2004, i);              //Tile
+			ppu.writeMemMappedReg(0x2004, i & 0xE3);       //Attributes
+			ppu.writeMemMappedReg(0x2004, i * 13);         //X
+		}
+
+		ppu.writeMemMappedReg(0x2000, 0x08);
+		ppu.writeMemMappedReg(0x2005, 0x03);
+		ppu.writeMemMappedReg(0x2005, 0x00);
+		ppu.writeMemMappedReg(0x2001, 0x1E);
+	}
+
+	//Every channel playing: both pulses with sweeps and envelopes, a mid range triangle, noise and a looping DMC sample
+	void setupAPU(APU& apu)
+	{
+		const uint8_t writes[][2] =
+		{
+			{0x15, 0x1F}, {0x17, 0x00},
+			{0x00, 0xBF}, {0x01, 0x00}, {0x02, 0xFD}, {0x03, 0x08},
+			{0x04, 0x4A}, {0x05, 0x9A}, {0x06, 0x7E}, {0x07, 0x09},
+			{0x08, 0xFF}, {0x0A, 0x54}, {0x0B, 0x09},
+			{0x0C, 0x3C}, {0x0E, 0x05}, {0x0F, 0x08},
+			{0x10, 0x4F}, {0x12, 0x00}, {0x13, 0x10}, {0x15, 0x1F}
+		};
+		for(auto& write : writes)
+			apu.writeMemMappedReg(0x4000 | write[0], write[1]);
+	}
+
+	//NROM is built from the real nestest image, MMC1 from a 128KB PRG-only image written to the temp directory
+	std::string writeMMC1Image()
+	{
+		std::string path = (std::filesystem::temp_directory_path() / "nes-benchmark-mmc1.nes").string();
+		std::ofstream image(path, std::ios::binary);
+		const char header[16] = {'N', 'E', 'S', 0x1A, 8, 0, 0x10, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+		image.write(header, 16);
+		for(int i = 0; i < 8 * 0x4000; ++i)
+			image.put((char)(i * 31));
+		return path;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const char* romPath = argc > 1 ? argv[1] : "roms/nestest.nes";
+	std::string filter = argc > 2 ? argv[2] : "";
+	std::vector<std::string> results;
+	volatile uint8_t sink = 0;
+
+	try
+	{
+		{
+			auto machine = std::make_unique<Machine>(aluMix);
+			measure(results, filter, "cpu/alu_mix/cycle", [&](uint64_t n){ runCPU(*machine, n); });
+		}
+		{
+			auto machine = std::make_unique<Machine>(memoryMix);
+			measure(results, filter, "cpu/memory_mix/cycle", [&](uint64_t n){ runCPU(*machine, n); });
+		}
+		{
+			auto machine = std::make_unique<Machine>(branchMix);
+			measure(results, filter, "cpu/branch_mix/cycle", [&](uint64_t n){ runCPU(*machine, n); });
+		}
+
+		{
+			auto machine = std::make_unique<Machine>(branchMix);
+			setupPPU(machine->ppu);
+			measure(results, filter, "ppu/tick/frame", [&](uint64_t n)
+			{
+				for(uint64_t i = 0; i < n; ++i)
+				{
+					while(!machine->frameReady)
+						machine->ppu.tick();
+					machine->frameReady = false;
+				}
+			});
+		}
+		{
+			auto machine = std::make_unique<Machine>(branchMix);
+			setupPPU(machine->ppu);
+			uint64_t clock = setupClock;
+			measure(results, filter, "ppu/catch_up/frame", [&](uint64_t n)
+			{
+				for(uint64_t i = 0; i < n; ++i)
+				{
+					clock += 341 * 262;
+					machine->ppu.catchUp(clock);
+				}
+			});
+		}
+
+		{
+			auto machine = std::make_unique<Machine>(branchMix);
+			setupAPU(machine->apu);
+			uint64_t cycle = 0;
+			int16_t samples[2048];
+			measure(results, filter, "apu/run/frame", [&](uint64_t n)
+			{
+				for(uint64_t i = 0; i < n; ++i)
+				{
+					cycle += 29781;
+					machine->apu.endFrame(cycle);
+					sink += machine->apu.readSamples(samples, 2048);
+				}
+			});
+		}
+
+		{
+			NROM nrom(std::make_shared<const RomImage>(romPath));
+			Cartridge& cart = nrom;
+			measure(results, filter, "nrom/readPRG/read", [&](uint64_t n)
+			{
+				for(uint64_t i = 0; i < n; ++i)
+					sink += cart.readPRG(0x8000 | (i & 0x7FFF));
+			});
+			measure(results, filter, "nrom/readCHR/read", [&](uint64_t n)
+			{
+				for(uint64_t i = 0; i < n; ++i)
+					sink += cart.readCHR(i & 0x1FFF);
+			});
+		}
+		{
+			//MMC1 CHR banking isn't implemented yet, so only its PRG path is measured
+			std::string path = writeMMC1Image();
+			MMC1 mmc1(std::make_shared<const RomImage>(path.c_str()));
+			Cartridge& cart = mmc1;
+			measure(results, filter, "mmc1/readPRG/read", [&](uint64_t n)
+			{
+				for(uint64_t i = 0; i < n; ++i)
+					sink += cart.readPRG(0x8000 | (i & 0x7FFF));
+			});
+			std::filesystem::remove(path);
+		}
+
+		measure(results, filter, "nes/load/rom", [&](uint64_t n)
+		{
+			for(uint64_t i = 0; i < n; ++i)
+			{
+				NES nes(romPath);
+				sink += nes.elapsedCycles();
+			}
+		});
+
+		{
+			NES nes(romPath);
+			measure(results, filter, "nes/prepare_frame_cycle_stepped/frame", [&](uint64_t n)
+			{
+				for(uint64_t i = 0; i < n; ++i)
+					nes.prepareFrame();
+			});
+		}
+		{
+			NES nes(romPath);
+			nes.setExecutionMode(instructionStepped);
+			measure(results, filter, "nes/prepare_frame_instruction_stepped/frame", [&](uint64_t n)
+			{
+				for(uint64_t i = 0; i < n; ++i)
+					nes.prepareFrame();
+			});
+		}
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	std::cout << "{\n  \"benchmarks\": [\n";
+	for(size_t i = 0; i < results.size(); ++i)
+		std::cout << results[i] << (i + 1 < results.size() ? ",\n" : "\n");
+	std::cout << "  ]\n}" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,73 @@
+//Runs a ROM without a window or frame pacing and reports how fast the core goes.
+//
+//	nes-headless <rom> <frames> [movie] [--instruction-stepped]
+//
+//A movie is a raw file with one byte of controller one input per frame (A, B, Select, Start, Up, Down, Left, Right from bit 0).
+//Frames past the end of the movie get no input.
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+#include "../src/include/NES.hpp"
+
+int main(int argc, char* argv[])
+{
+	if(argc < 3)
+	{
+		std::cerr << "Usage: " << argv[0] << " <rom> <frames> [movie] [--instruction-stepped]" << std::endl;
+		return 1;
+	}
+
+	const char* romPath = argv[1];
+	long frames = std::atol(argv[2]);
+	const char* moviePath = nullptr;
+	ExecutionMode mode = cycleStepped;
+
+	for(int i = 3; i < argc; ++i)
+	{
+		if(std::strcmp(argv[i], "--instruction-stepped") == 0)
+			mode = instructionStepped;
+		else
+			moviePath = argv[i];
+	}
+
+	std::vector<uint8_t> movie;
+	if(moviePath)
+	{
+		std::ifstream movieFile(moviePath, std::ios::binary);
+		if(!movieFile)
+		{
+			std::cerr << "Could not open movie " << moviePath << std::endl;
+			return 1;
+		}
+		movie.assign(std::istreambuf_iterator<char>(movieFile), std::istreambuf_iterator<char>());
+	}
+
+	try
+	{
+		NES nes(romPath);
+		nes.setExecutionMode(mode);
+
+		auto start = std::chrono::steady_clock::now();
+		for(long frame = 0; frame < frames; ++frame)
+		{
+			nes.setButtons(0, (size_t)frame < movie.size() ? movie[frame] : 0x00);
+			nes.prepareFrame();
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::cout << frames << " frames in " << seconds << " s" << std::endl;
+		std::cout << "frames/sec: " << frames / seconds << " (" << frames / seconds / 60.0988 << "x NTSC)" << std::endl;
+		std::cout << "cycles/sec: " << nes.elapsedCycles() / seconds << std::endl;
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,273 @@
+//Runs a ROM with an instruction trace attached and compares it line by line against a reference log in the nestest.log format.
+//
+//	nes-trace-diff <rom> <log> [--start XXXX] [--ppu] [--instruction-stepped] [--save trace.bin]
+//
+//--start overrides the reset vector (C000 runs nestest in automation mode). P is compared without the B and unused bits, which
+//only exist on the stack. --ppu also compares the scanline and dot, in either the "PPU:sl,dot" or the older "CYC:dot SL:sl" log
+//format. The log is parsed in place without iostreams so multi gigabyte logs are fine.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "../src/include/NES.hpp"
+#include "../src/include/Trace.hpp"
+
+namespace
+{
+	struct LogLine
+	{
+		uint16_t PC;
+		uint8_t A, X, Y, P, SP;
+		int scanline, dot;
+		bool hasPPU;
+		const char* text;
+		size_t length;
+	};
+
+	int hexDigit(char c)
+	{
+		if(c >= '0' && c <= '9')
+			return c - '0';
+		if(c >= 'A' && c <= 'F')
+			return c - 'A' + 10;
+		if(c >= 'a' && c <= 'f')
+			return c - 'a' + 10;
+		return -1;
+	}
+
+	bool hexByte(const char* p, const char* end, uint8_t& value)
+	{
+		if(end - p < 2 || hexDigit(p[0]) < 0 || hexDigit(p[1]) < 0)
+			return false;
+		value = (hexDigit(p[0]) << 4) | hexDigit(p[1]);
+		return true;
+	}
+
+	int decimal(const char*& p, const char* end)
+	{
+		while(p < end && *p == ' ')
+			++p;
+		int value = 0;
+		while(p < end && *p >= '0' && *p <= '9')
+			value = value * 10 + (*p++ - '0');
+		return value;
+	}
+
+	const char* find(const char* p, const char* end, const char* needle)
+	{
+		size_t length = std::strlen(needle);
+		for(; p + length <= end; ++p)
+			if(*p == needle[0] && std::memcmp(p, needle, length) == 0)
+				return p;
+		return nullptr;
+	}
+
+	//Reads the register columns of one log line. Fields are found by their labels since the disassembly column varies in width
+	bool parseLine(const char* p, const char* end, LogLine& line)
+	{
+		line.text = p;
+		line.length = end - p;
+		uint8_t high, low;
+		if(!hexByte(p, end, high) || !hexByte(p + 2, end, low))
+			return false;
+		line.PC = (high << 8) | low;
+
+		//Registers start at column 48 in the canonical log, anything else is searched for
+		const char* registers = (end - p > 74 && std::memcmp(p + 47, " A:", 3) == 0) ? p + 47 : find(p + 4, end, " A:");
+		if(!registers || end - registers < 26)
+			return false;
+		registers += 1;
+		if(!hexByte(registers + 2, end, line.A) || !hexByte(registers + 7, end, line.X) || !hexByte(registers + 12, end, line.Y) ||
+		   !hexByte(registers + 17, end, line.P) || !hexByte(registers + 23, end, line.SP))
+			return false;
+
+		line.hasPPU = false;
+		if(const char* ppu = find(registers + 25, end, "PPU:"))
+		{
+			ppu += 4;
+			line.scanline = decimal(ppu, end);
+			if(ppu < end && *ppu == ',')
+				++ppu;
+			line.dot = decimal(ppu, end);
+			line.hasPPU = true;
+		}
+		else if(const char* sl = find(registers + 25, end, "SL:"))
+		{
+			const char* cyc = find(registers + 25, end, "CYC:");
+			if(cyc)
+			{
+				cyc += 4;
+				sl += 3;
+				line.dot = decimal(cyc, end);
+				line.scanline = decimal(sl, end);
+				line.hasPPU = true;
+			}
+		}
+		return true;
+	}
+
+	void printEntry(const char* label, const TraceEntry& entry)
+	{
+		std::printf("%s %04X  %02X  A:%02X X:%02X Y:%02X P:%02X SP:%02X PPU:%3d,%3d CYC:%u\n", label, entry.PC, entry.opcode,
+					entry.A, entry.X, entry.Y, entry.P, entry.SP, entry.scanline, entry.dot, entry.cycle);
+	}
+
+	class LogReader
+	{
+	public:
+		LogReader(const char* path)
+		{
+			std::ifstream file(path, std::ios::binary | std::ios::ate);
+			if(!file)
+				throw TraceFileError("Could not open log", path);
+			text.resize((size_t)file.tellg());
+			file.seekg(0);
+			file.read(text.data(), text.size());
+			position = text.data();
+			end = text.data() + text.size();
+		}
+
+		//Skips blank lines, false once the log runs out
+		bool next(LogLine& line)
+		{
+			while(position < end)
+			{
+				const char* lineEnd = (const char*)std::memchr(position, '\n', end - position);
+				if(!lineEnd)
+					lineEnd = end;
+				const char* start = position;
+				position = lineEnd + 1;
+				++lineNumber;
+
+				const char* trimmed = lineEnd;
+				if(trimmed > start && trimmed[-1] == '\r')
+					--trimmed;
+				if(trimmed == start)
+					continue;
+				if(!parseLine(start, trimmed, line))
+					throw TraceFileError("Could not parse log line " + std::to_string(lineNumber), std::string(start, trimmed));
+				return true;
+			}
+			return false;
+		}
+
+		size_t line() const { return lineNumber; }
+		size_t bytes() const { return text.size(); }
+
+	private:
+		std::vector<char> text;
+		const char* position;
+		const char* end;
+		size_t lineNumber = 0;
+	};
+}
+
+int main(int argc, char* argv[])
+{
+	if(argc < 3)
+	{
+		std::cerr << "Usage: " << argv[0] << " <rom> <log> [--start XXXX] [--ppu] [--instruction-stepped] [--save trace.bin]" << std::endl;
+		return 1;
+	}
+
+	int start = -1;
+	bool comparePPU = false;
+	ExecutionMode mode = cycleStepped;
+	const char* savePath = nullptr;
+	for(int i = 3; i < argc; ++i)
+	{
+		if(std::strcmp(argv[i], "--start") == 0 && i + 1 < argc)
+			start = std::strtol(argv[++i], nullptr, 16);
+		else if(std::strcmp(argv[i], "--ppu") == 0)
+			comparePPU = true;
+		else if(std::strcmp(argv[i], "--instruction-stepped") == 0)
+			mode = instructionStepped;
+		else if(std::strcmp(argv[i], "--save") == 0 && i + 1 < argc)
+			savePath = argv[++i];
+	}
+
+	try
+	{
+		LogReader log(argv[2]);
+		NES nes(argv[1]);
+		nes.setExecutionMode(mode);
+
+		//A frame is well under 64K instructions, the trace is checked and cleared after every frame
+		Trace trace(1 << 16);
+		nes.setTrace(&trace);
+		if(start >= 0)
+			nes.setProgramCounter(start);
+
+		uint64_t matched = 0;
+		std::string stopReason;
+		LogLine line;
+		bool logDone = false;
+
+		while(!logDone && stopReason.empty())
+		{
+			try
+			{
+				nes.prepareFrame();
+			}
+			catch(std::exception& e)
+			{
+				stopReason = e.what();
+			}
+
+			if(trace.total() > trace.size())
+			{
+				std::cerr << "Trace overflowed within one frame" << std::endl;
+				return 1;
+			}
+
+			for(size_t i = 0; i < trace.size(); ++i)
+			{
+				if(!log.next(line))
+				{
+					logDone = true;
+					break;
+				}
+
+				const TraceEntry& entry = trace[i];
+				bool same = entry.PC == line.PC && entry.A == line.A && entry.X == line.X && entry.Y == line.Y &&
+							(entry.P & 0xCF) == (line.P & 0xCF) && entry.SP == line.SP;
+				if(same && comparePPU && line.hasPPU)
+					same = entry.scanline == line.scanline && entry.dot == line.dot;
+
+				if(!same)
+				{
+					std::printf("Mismatch at log line %zu after %llu matching instructions\n", log.line(), (unsigned long long)matched);
+					for(size_t j = (i > 8 ? i - 8 : 0); j < i; ++j)
+						printEntry("   ", trace[j]);
+					std::printf("log %.*s\n", (int)line.length, line.text);
+					printEntry("got", entry);
+					if(savePath)
+						trace.save(savePath);
+					return 1;
+				}
+				++matched;
+			}
+
+			if(savePath && (logDone || !stopReason.empty()))
+				trace.save(savePath);
+			trace.clear();
+		}
+
+		if(!logDone && log.next(line))
+		{
+			std::printf("Emulation stopped at log line %zu after %llu matching instructions: %s\n", log.line(), (unsigned long long)matched, stopReason.c_str());
+			return 1;
+		}
+
+		std::printf("All %llu instructions in the log match (%zu bytes)\n", (unsigned long long)matched, log.bytes());
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}